@@ -22,6 +22,15 @@
 FunctionQueue<void> Application::renderFunctions = FunctionQueue<void>();
 FunctionQueue<void> Application::postProcessFunctions = FunctionQueue<void>();
 RenderInstance Application::instance = RenderInstance();
+IndirectMeshBatch Application::indirectBatch = IndirectMeshBatch();
+JobSystem Application::jobs = JobSystem();
+TessellationCache Application::tessellationCache = TessellationCache();
+TextureAtlas Application::textureAtlas = TextureAtlas();
+SpriteBatch Application::spriteBatch = SpriteBatch(textureAtlas);
+AssetLoader Application::assetLoader = AssetLoader();
+TransformHierarchy Application::transforms = TransformHierarchy();
+FrameArenaRing Application::frameArenas = FrameArenaRing();
+DamageTracker Application::damage = DamageTracker();
 int Application::width = 0;
 int Application::height = 0;
 
@@ -56,8 +65,9 @@ void Application::initOpenGL() {
         return;
     }
 
-    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
-    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+    // Ask for OpenGL 4.5 first; the context is created again with 3.3 if the driver refuses it
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, preferOpenGL45 ? 4 : 3);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, preferOpenGL45 ? 5 : 3);
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
 
     window = SDL_CreateWindow(
@@ -76,10 +86,16 @@ void Application::initOpenGL() {
     }
 
     SDL_GLContext context = SDL_GL_CreateContext(window);
+    if (!context && preferOpenGL45) {
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+        context = SDL_GL_CreateContext(window);
+    }
     if (!context) {
         std::cerr << "Failed to create OpenGL context: " << SDL_GetError() << std::endl;
         SDL_DestroyWindow(window);
         SDL_Quit();
+        return;
     }
 
     if (SDL_GL_MakeCurrent(window, context) < 0) {
@@ -101,6 +117,7 @@ void Application::initOpenGL() {
 
     SDL_GL_SetSwapInterval(1);
 
+    instance.directStateAccess = preferOpenGL45 && GLEW_VERSION_4_5;
     instance.createFramebuffer(width, height);
 }
 
@@ -109,26 +126,74 @@ void Application::mainLoop() {
     SDL_Event event;
 
     while (running) {
-        while (SDL_PollEvent(&event)) {
+        // With nothing to draw or upload the loop sleeps until an event arrives. The timeout
+        // still lets work finished on other threads, like decoded assets, reach the screen.
+        // Render functions run after the damage of their frame was collected, so whatever
+        // they moved or changed in the matrices is only picked up here
+        bool viewChanged = damage.checkMatrices();
+        bool idle = !damage.isDamaged() && !transforms.isDirty() && assetLoader.pendingUploads() == 0;
+        bool hasEvent = idle ? SDL_WaitEventTimeout(&event, idleTimeoutMilliseconds) : SDL_PollEvent(&event);
+        while (hasEvent) {
             if (event.type == SDL_QUIT) {
                 running = false;
             }
+            else if (event.type == SDL_WINDOWEVENT) {
+                damage.invalidate();
+                viewChanged = true;
+            }
+            hasEvent = SDL_PollEvent(&event);
+        }
+
+        frameArenas.nextFrame();
+        textureAtlas.nextFrame();
+        // Uploads can change textures that are already on screen
+        if (assetLoader.pendingUploads() > 0) {
+            damage.invalidate();
+        }
+        assetLoader.pump();
+        transforms.update();
+        transforms.upload();
+        damage.nodesMoved(transforms.getUpdated());
+        viewChanged = damage.checkMatrices() || viewChanged;
+        // Curved shapes pick the level of detail of their new size on screen
+        tessellationCache.updateLevels(transforms.getUpdated(), viewChanged);
+
+        if (!damage.isDamaged()) {
+            continue;
         }
 
-        renderFunctions.run();
+        const std::vector<DamageRect>& regions = damage.collect(instance.getPostProcessSpread(), width, height);
+        if (regions.empty()) {
+            continue;
+        }
+
+        for (const DamageRect& region : regions) {
+            instance.beginFrame(region);
+            renderFunctions.run();
+        }
+        instance.endFrame(regions);
 
         SDL_GL_SwapWindow(window);
     }
 
+    jobs.shutdown();
+    assetLoader.shutdown();
+    tessellationCache.clear();
+    indirectBatch.clear();
+    spriteBatch.clear();
+    textureAtlas.clear();
+    transforms.clear();
     SDL_DestroyWindow(window);
     SDL_Quit();
 }
 
 void Application::applyPostProcess(PostProcessUnit unit) {
-    instance.postProcessUnit = unit;
-    if (unit.isLocal && unit.type == AtlasPostProcessing::Blur) {
-        instance.createPongBuffers(width, height);
-    }
+    instance.setPostProcess(std::move(unit));
+}
+
+// Consecutive pointwise effects added this way are fused into a single pass
+void Application::addPostProcess(PostProcessUnit unit) {
+    instance.addPostProcess(std::move(unit));
 }
 
 
@@ -0,0 +1,300 @@
+/*
+* asset_loader.cpp
+* As part of the Atlas project
+* Created by Maxims Enterprise in 2024
+* --------------------------------------
+* Description: Asynchronous asset loading with staged GPU uploads
+* Copyright (c) 2024 Maxims Enterprise
+*/
+
+#include <atlas/core/asset_loader.h>
+#include "atlas/application.h"
+#include "atlas/core/scene_file.h"
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <cstdint>
+#include <stdexcept>
+
+static std::string readTextFile(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) {
+        throw std::runtime_error("Failed to open " + path);
+    }
+    return {(std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>()};
+}
+
+// Reads the next header token of a PPM or PAM file, skipping comments
+static std::string readHeaderToken(std::istream& stream) {
+    std::string token;
+    while (stream >> token) {
+        if (token[0] != '#') {
+            return token;
+        }
+        std::getline(stream, token);
+    }
+    throw std::runtime_error("Unexpected end of image header");
+}
+
+static int readHeaderNumber(std::istream& stream, const std::string& path) {
+    std::string token = readHeaderToken(stream);
+    if (token.size() > 9 || token.find_first_not_of("0123456789") != std::string::npos) {
+        throw std::runtime_error(path + " has a malformed image header");
+    }
+    return std::stoi(token);
+}
+
+Image decodeImage(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Failed to open " + path);
+    }
+
+    Image image;
+    int channels = 3;
+    int maxValue = 0;
+    std::string format = readHeaderToken(file);
+    if (format == "P6") {
+        image.width = readHeaderNumber(file, path);
+        image.height = readHeaderNumber(file, path);
+        maxValue = readHeaderNumber(file, path);
+    }
+    else if (format == "P7") {
+        for (std::string token = readHeaderToken(file); token != "ENDHDR"; token = readHeaderToken(file)) {
+            if (token == "WIDTH") image.width = readHeaderNumber(file, path);
+            else if (token == "HEIGHT") image.height = readHeaderNumber(file, path);
+            else if (token == "DEPTH") channels = readHeaderNumber(file, path);
+            else if (token == "MAXVAL") maxValue = readHeaderNumber(file, path);
+            else if (token == "TUPLTYPE") readHeaderToken(file);
+        }
+    }
+    else {
+        throw std::runtime_error(path + " is not a binary PPM or PAM image");
+    }
+
+    // Samples above 255 take two bytes each, which no upload path accepts
+    if (image.width <= 0 || image.height <= 0 || maxValue <= 0 || maxValue > 255 || (channels != 3 && channels != 4)) {
+        throw std::runtime_error(path + " uses an unsupported image layout");
+    }
+    // A single whitespace character separates the header from the pixels
+    file.get();
+
+    size_t pixelCount = static_cast<size_t>(image.width) * image.height;
+    std::vector<unsigned char> raw(pixelCount * channels);
+    if (!file.read(reinterpret_cast<char*>(raw.data()), static_cast<std::streamsize>(raw.size()))) {
+        throw std::runtime_error(path + " is truncated");
+    }
+
+    // Smaller ranges are stretched to the full byte
+    if (maxValue != 255) {
+        for (unsigned char& sample : raw) {
+            sample = static_cast<unsigned char>((std::min<int>(sample, maxValue) * 255 + maxValue / 2) / maxValue);
+        }
+    }
+
+    if (channels == 4) {
+        image.pixels = std::move(raw);
+        return image;
+    }
+
+    image.pixels.resize(pixelCount * 4);
+    for (size_t i = 0; i < pixelCount; i++) {
+        image.pixels[i * 4] = raw[i * 3];
+        image.pixels[i * 4 + 1] = raw[i * 3 + 1];
+        image.pixels[i * 4 + 2] = raw[i * 3 + 2];
+        image.pixels[i * 4 + 3] = 255;
+    }
+    return image;
+}
+
+AssetHandle<ShaderAsset> AssetLoader::loadShader(std::string vertexPath, std::string fragmentPath) {
+    auto promise = std::make_shared<std::promise<ShaderAsset>>();
+    AssetHandle<ShaderAsset> handle(promise->get_future().share(), renderThread.load());
+
+    submitDecode([this, promise, vertexPath = std::move(vertexPath), fragmentPath = std::move(fragmentPath)]() {
+        auto sources = std::make_shared<std::pair<std::string, std::string>>();
+        try {
+            sources->first = readTextFile(vertexPath);
+            sources->second = readTextFile(fragmentPath);
+        }
+        catch (const std::exception& error) {
+            std::cerr << "Failed to load shader: " << error.what() << std::endl;
+            promise->set_exception(std::current_exception());
+            return;
+        }
+
+        submitUpload([promise, sources]() {
+            GLuint program = Application::instance.getProgramFromSource(sources->first, sources->second);
+            promise->set_value({program});
+            return true;
+        });
+    });
+    return handle;
+}
+
+AssetHandle<TextureAsset> AssetLoader::loadTexture(std::string path) {
+    auto promise = std::make_shared<std::promise<TextureAsset>>();
+    AssetHandle<TextureAsset> handle(promise->get_future().share(), renderThread.load());
+
+    submitDecode([this, promise, path = std::move(path)]() {
+        std::shared_ptr<Image> image;
+        try {
+            image = std::make_shared<Image>(decodeImage(path));
+        }
+        catch (const std::exception& error) {
+            std::cerr << "Failed to load texture: " << error.what() << std::endl;
+            promise->set_exception(std::current_exception());
+            return;
+        }
+
+        // Each step streams as many rows as fit in one staging buffer
+        submitUpload([this, promise, image, path, texture = GLuint(0), row = 0]() mutable {
+            if (texture == 0) {
+                glGenTextures(1, &texture);
+                glBindTexture(GL_TEXTURE_2D, texture);
+                glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, image->width, image->height, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                             nullptr);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            }
+
+            size_t rowBytes = static_cast<size_t>(image->width) * 4;
+            int rows = std::min(image->height - row, std::max(1, static_cast<int>(stagingBufferSize / rowBytes)));
+            size_t bytes = rowBytes * rows;
+
+            // Orphaning the staging buffer lets the driver keep the previous upload in flight
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, acquireStagingBuffer());
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(bytes), nullptr, GL_STREAM_DRAW);
+            void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, static_cast<GLsizeiptr>(bytes),
+                                            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+            if (mapped == nullptr) {
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+                glDeleteTextures(1, &texture);
+                std::cerr << "Failed to load texture: could not map the staging buffer for " << path << std::endl;
+                promise->set_exception(std::make_exception_ptr(
+                    std::runtime_error("Failed to map the staging buffer for " + path)));
+                return true;
+            }
+            std::memcpy(mapped, image->pixels.data() + rowBytes * row, bytes);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+            glBindTexture(GL_TEXTURE_2D, texture);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, row, image->width, rows, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            glBindTexture(GL_TEXTURE_2D, 0);
+
+            row += rows;
+            if (row < image->height) {
+                return false;
+            }
+            promise->set_value({texture, image->width, image->height});
+            return true;
+        });
+    });
+    return handle;
+}
+
+AssetHandle<CoreMesh> AssetLoader::loadMesh(std::string path) {
+    auto promise = std::make_shared<std::promise<CoreMesh>>();
+    AssetHandle<CoreMesh> handle(promise->get_future().share(), renderThread.load());
+
+    submitDecode([this, promise, path = std::move(path)]() {
+        std::shared_ptr<CoreGeometry> geometry;
+        try {
+            geometry = std::make_shared<CoreGeometry>(BakedScene(path).getGeometry());
+        }
+        catch (const std::exception& error) {
+            std::cerr << "Failed to load mesh: " << error.what() << std::endl;
+            promise->set_exception(std::current_exception());
+            return;
+        }
+
+        submitUpload([promise, geometry]() {
+            CoreMesh mesh = Application::instance.uploadMesh(geometry->vertices, geometry->indices, GL_TRIANGLES);
+            computeBounds(*geometry, mesh);
+            promise->set_value(mesh);
+            return true;
+        });
+    });
+    return handle;
+}
+
+AssetHandle<std::shared_ptr<const Image>> AssetLoader::loadImage(std::string path) {
+    auto promise = std::make_shared<std::promise<std::shared_ptr<const Image>>>();
+    AssetHandle<std::shared_ptr<const Image>> handle(promise->get_future().share());
+
+    submitDecode([promise, path = std::move(path)]() {
+        try {
+            promise->set_value(std::make_shared<const Image>(decodeImage(path)));
+        }
+        catch (const std::exception& error) {
+            std::cerr << "Failed to load image: " << error.what() << std::endl;
+            promise->set_exception(std::current_exception());
+        }
+    });
+    return handle;
+}
+
+void AssetLoader::pump() {
+    renderThread.store(std::this_thread::get_id());
+    auto start = std::chrono::steady_clock::now();
+    std::chrono::duration<double, std::milli> budget(uploadBudgetMilliseconds);
+
+    // At least one step runs every frame so that uploads always make progress
+    do {
+        UploadStep step;
+        {
+            std::lock_guard lock(uploadMutex);
+            if (uploads.empty()) {
+                break;
+            }
+            step = std::move(uploads.front());
+            uploads.pop_front();
+        }
+
+        if (!step()) {
+            std::lock_guard lock(uploadMutex);
+            uploads.push_front(std::move(step));
+        }
+    }
+    while (std::chrono::steady_clock::now() - start < budget);
+}
+
+void AssetLoader::shutdown() {
+    {
+        std::lock_guard lock(uploadMutex);
+        uploads.clear();
+    }
+    glDeleteBuffers(3, stagingBuffers);
+    stagingBuffers[0] = stagingBuffers[1] = stagingBuffers[2] = 0;
+}
+
+size_t AssetLoader::pendingUploads() {
+    std::lock_guard lock(uploadMutex);
+    return uploads.size();
+}
+
+void AssetLoader::submitDecode(std::function<void()> job) {
+    Application::jobs.submit(std::move(job));
+}
+
+void AssetLoader::submitUpload(UploadStep step) {
+    std::lock_guard lock(uploadMutex);
+    uploads.push_back(std::move(step));
+}
+
+GLuint AssetLoader::acquireStagingBuffer() {
+    if (stagingBuffers[0] == 0) {
+        glGenBuffers(3, stagingBuffers);
+    }
+    GLuint buffer = stagingBuffers[nextStagingBuffer];
+    nextStagingBuffer = (nextStagingBuffer + 1) % 3;
+    return buffer;
+}
@@ -10,10 +10,12 @@
 #include <atlas/core/core_rendering.h>
 #include <atlas/data.hpp>
 #include "atlas/application.h"
+#include <cstdint>
 #include <fstream>
 #include <iostream>
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <glm/gtc/matrix_transform.hpp>
 
 glm::mat4 RenderInstance::model = glm::mat4(1.0f);
 glm::mat4 RenderInstance::view = glm::mat4(1.0f);
@@ -31,6 +33,10 @@ GLuint RenderInstance::getProgramFromLocal(const char* vertexShader, const char*
     std::string vertexSource((std::istreambuf_iterator<char>(vertexFile)), std::istreambuf_iterator<char>());
     std::string fragmentSource((std::istreambuf_iterator<char>(fragmentFile)), std::istreambuf_iterator<char>());
 
+    return getProgramFromSource(vertexSource, fragmentSource);
+}
+
+GLuint RenderInstance::getProgramFromSource(const std::string& vertexSource, const std::string& fragmentSource) {
     const char* vertexSourceC = vertexSource.c_str();
     const char* fragmentSourceC = fragmentSource.c_str();
 
@@ -53,26 +59,90 @@ GLuint RenderInstance::getProgramFromLocal(const char* vertexShader, const char*
     return shaderProgram;
 }
 
-GLuint RenderInstance::getProgramFromShader(AtlasShader shader) {
-    switch (shader) {
-    case AtlasShader::Default:
+GLuint RenderInstance::getComputeProgramFromLocal(const char* computeShader) {
+    std::ifstream computeFile(computeShader);
+    if (!computeFile) {
+        std::cerr << "Failed to open compute shader file" << std::endl;
+        return 0;
+    }
+
+    std::string computeSource((std::istreambuf_iterator<char>(computeFile)), std::istreambuf_iterator<char>());
+    const char* computeSourceC = computeSource.c_str();
+
+    GLuint computeShaderID = glCreateShader(GL_COMPUTE_SHADER);
+    glShaderSource(computeShaderID, 1, &computeSourceC, nullptr);
+    glCompileShader(computeShaderID);
+
+    GLuint shaderProgram = glCreateProgram();
+    glAttachShader(shaderProgram, computeShaderID);
+    glLinkProgram(shaderProgram);
+
+    glDeleteShader(computeShaderID);
+
+    return shaderProgram;
+}
+
+const std::string& RenderInstance::getAtlasRoot() {
+    // ~/.atlas is read once, later calls reuse the same string
+    static std::string atlasShaderSource;
+    if (atlasShaderSource.empty()) {
         std::string home = std::getenv("HOME");
         std::ifstream atlasShaderPath(home + "/.atlas");
         if (!atlasShaderPath) {
             throw std::runtime_error("Failed to open ~/.atlas");
         }
 
-        std::string atlasShaderSource;
         std::getline(atlasShaderPath, atlasShaderSource);
+    }
+    return atlasShaderSource;
+}
+
+GLuint RenderInstance::getProgramFromShader(AtlasShader shader) {
+    const std::string& atlasShaderSource = getAtlasRoot();
 
+    switch (shader) {
+    case AtlasShader::Default:
+    {
         std::string fragmentRoute = atlasShaderSource + "shaders/normal/normal.frag";
         std::string vertexRoute = atlasShaderSource + "shaders/normal/normal.vert";
 
         return getProgramFromLocal(vertexRoute.c_str(), fragmentRoute.c_str());
     }
+    case AtlasShader::Sprite:
+    {
+        std::string fragmentRoute = atlasShaderSource + "shaders/sprite/sprite.frag";
+        std::string vertexRoute = atlasShaderSource + "shaders/sprite/sprite.vert";
+
+        return getProgramFromLocal(vertexRoute.c_str(), fragmentRoute.c_str());
+    }
+    }
+    return 0;
 }
 
-void RenderInstance::renderToScreen(std::vector<CoreVertex> vertices, GLuint program, int count, GLenum mode) {
+GLuint RenderInstance::getProgram(const Shader& shader) {
+    if (!shader.isLocal) {
+        GLuint& program = shaderPrograms[static_cast<size_t>(shader.type)];
+        if (program == 0) {
+            program = getProgramFromShader(shader.type);
+        }
+        return program;
+    }
+
+    // Custom shaders are few, so a linear search compares the paths without building a key
+    for (const LocalProgram& cached : localPrograms) {
+        if (cached.vertexShader == shader.vertexShader && cached.fragmentShader == shader.fragmentShader) {
+            return cached.program;
+        }
+    }
+
+    GLuint program = getProgramFromLocal(shader.vertexShader, shader.fragmentShader);
+    if (program != 0) {
+        localPrograms.push_back({shader.vertexShader, shader.fragmentShader, program});
+    }
+    return program;
+}
+
+void RenderInstance::renderToScreen(const std::vector<CoreVertex>& vertices, GLuint program, int count, GLenum mode) {
     GLuint VAO, VBO;
     glGenVertexArrays(1, &VAO);
     glGenBuffers(1, &VBO);
@@ -111,15 +181,36 @@ void RenderInstance::renderToScreen(std::vector<CoreVertex> vertices, GLuint pro
 }
 
 void RenderInstance::createFramebuffer(int width, int height) {
-    glGenFramebuffers(1, &framebuffers[0]);
-    glBindFramebuffer(GL_FRAMEBUFFER, framebuffers[0]);
+    if (directStateAccess) {
+        glCreateFramebuffers(1, &sceneFramebuffer);
+
+        glCreateTextures(GL_TEXTURE_2D, 1, &sceneTexture);
+        glTextureStorage2D(sceneTexture, 1, GL_RGBA8, width, height);
+        glTextureParameteri(sceneTexture, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTextureParameteri(sceneTexture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glNamedFramebufferTexture(sceneFramebuffer, GL_COLOR_ATTACHMENT0, sceneTexture, 0);
+
+        glCreateRenderbuffers(1, &depthBuffer);
+        glNamedRenderbufferStorage(depthBuffer, GL_DEPTH_COMPONENT24, width, height);
+        glNamedFramebufferRenderbuffer(sceneFramebuffer, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+
+        if (glCheckNamedFramebufferStatus(sceneFramebuffer, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            std::cerr << "Framebuffer creation failed!" << std::endl;
+            GLuint error = glGetError();
+            std::cerr << "OpenGL Error: " << error << std::endl;
+        }
+        return;
+    }
+
+    glGenFramebuffers(1, &sceneFramebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, sceneFramebuffer);
 
-    glGenTextures(1, &textures[0]);
-    glBindTexture(GL_TEXTURE_2D, textures[0]);
+    glGenTextures(1, &sceneTexture);
+    glBindTexture(GL_TEXTURE_2D, sceneTexture);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textures[0], 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, sceneTexture, 0);
 
     glGenRenderbuffers(1, &depthBuffer);
     glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
@@ -135,7 +226,8 @@ void RenderInstance::createFramebuffer(int width, int height) {
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
-void RenderInstance::renderToFramebuffer(std::vector<CoreVertex> vertices, GLuint program, int count, GLenum mode) {
+void RenderInstance::renderToFramebuffer(const std::vector<CoreVertex>& vertices, GLuint program, int count,
+                                         GLenum mode) {
     GLuint VAO, VBO;
     glGenVertexArrays(1, &VAO);
     glGenBuffers(1, &VBO);
@@ -152,15 +244,8 @@ void RenderInstance::renderToFramebuffer(std::vector<CoreVertex> vertices, GLuin
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindVertexArray(0);
 
-    std::function<void()> renderFunction = [program, VAO, count, mode, this]()
+    std::function<void()> renderFunction = [program, VAO, count, mode]()
     {
-        std::cout << "Framebuffer 0: " << framebuffers[0] << std::endl;
-        std::cout << "Framebuffer 1: " << framebuffers[1] << std::endl;
-
-        glBindFramebuffer(GL_FRAMEBUFFER, framebuffers[0]);
-
-        glViewport(0, 0, Application::width, Application::height);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         glUseProgram(program);
 
         GLint modelLoc = glGetUniformLocation(program, "model");
@@ -174,119 +259,393 @@ void RenderInstance::renderToFramebuffer(std::vector<CoreVertex> vertices, GLuin
         glBindVertexArray(VAO);
         glDrawArrays(mode, 0, count);
         glBindVertexArray(0);
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        applyAnyFramebufferEffect(textures[0]);
     };
 
     Application::renderFunctions.add_function(renderFunction);
 }
 
-void RenderInstance::applyAnyFramebufferEffect(GLuint texture) {
-    GLuint program;
-    if (postProcessUnit.isLocal) {
+CoreMesh RenderInstance::uploadMesh(const CoreVertex* vertices, size_t vertexCount, const GLuint* indices,
+                                    size_t indexCount, GLenum mode) {
+    if (directStateAccess) {
+        return Application::indirectBatch.allocate(vertices, vertexCount, indices, indexCount, mode);
+    }
+
+    CoreMesh mesh;
+    glGenVertexArrays(1, &mesh.vao);
+    glGenBuffers(1, &mesh.vbo);
+    glGenBuffers(1, &mesh.ebo);
+
+    glBindVertexArray(mesh.vao);
+    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo);
+    glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(CoreVertex), vertices, GL_STATIC_DRAW);
+
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(CoreVertex), (void*)0); // Position
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(CoreVertex), (void*)offsetof(CoreVertex, color)); // Color
+    glEnableVertexAttribArray(1);
+
+    // The element buffer binding is VAO state, so it must stay bound until the VAO is unbound
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(GLuint), indices, GL_STATIC_DRAW);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+    mesh.indexCount = static_cast<GLsizei>(indexCount);
+    mesh.mode = mode;
+    return mesh;
+}
+
+void RenderInstance::destroyMesh(CoreMesh& mesh) {
+    // Pooled meshes share buffers owned by the indirect batch or a baked scene
+    if (mesh.pooled) {
+        mesh = CoreMesh();
+        return;
+    }
+
+    glDeleteBuffers(1, &mesh.vbo);
+    glDeleteBuffers(1, &mesh.ebo);
+    glDeleteVertexArrays(1, &mesh.vao);
+    mesh = CoreMesh();
+}
+
+// Draws one mesh with its own program, reading the global matrices at draw time
+static void drawMesh(const CoreMesh& mesh, GLuint program, glm::vec3 offset, TransformNode node) {
+    glUseProgram(program);
+
+    GLint modelLoc = glGetUniformLocation(program, "model");
+    GLint viewLoc = glGetUniformLocation(program, "view");
+    GLint projectionLoc = glGetUniformLocation(program, "projection");
+    GLint offsetLoc = glGetUniformLocation(program, "offset");
+    GLint useTransformsLoc = glGetUniformLocation(program, "useTransforms");
+
+    glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(RenderInstance::view));
+    glUniformMatrix4fv(projectionLoc, 1, GL_FALSE, glm::value_ptr(RenderInstance::projection));
+
+    if (node == ATLAS_NO_TRANSFORM) {
+        // Shaders that know nothing about the hierarchy still get the offset through the model matrix
+        glm::mat4 meshModel = glm::translate(RenderInstance::model, offset);
+        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(meshModel));
+        glUniform3f(offsetLoc, 0.0f, 0.0f, 0.0f);
+        glUniform1i(useTransformsLoc, 0);
     }
     else {
-        switch (postProcessUnit.type) {
-        case AtlasPostProcessing::None:
-        {
-            std::string home = std::getenv("HOME");
-            std::ifstream atlasShaderPath(home + "/.atlas");
-            if (!atlasShaderPath) {
-                throw std::runtime_error("Failed to open ~/.atlas");
-            }
+        // The node's world matrix sits between the global model matrix and the shape offset
+        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(RenderInstance::model));
+        glUniform3fv(offsetLoc, 1, glm::value_ptr(offset));
+        glUniform1i(useTransformsLoc, 1);
+        glUniform1i(glGetUniformLocation(program, "transformIndex"), node);
+        glUniform1i(glGetUniformLocation(program, "transforms"), 1);
+
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_BUFFER, Application::transforms.getTexture());
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    glBindVertexArray(mesh.vao);
+    glDrawElementsBaseVertex(mesh.mode, mesh.indexCount, GL_UNSIGNED_INT,
+                             (void*)(mesh.firstIndex * sizeof(GLuint)), mesh.baseVertex);
+    glBindVertexArray(0);
+}
+
+void RenderInstance::renderMeshToFramebuffer(const CoreMesh& mesh, GLuint program, glm::vec3 offset,
+                                             TransformNode node) {
+    Application::renderFunctions.add_function([program, mesh, offset, node]() {
+        drawMesh(mesh, program, offset, node);
+    });
+}
+
+size_t RenderInstance::submitMesh(const CoreMesh& mesh, GLuint program, glm::vec3 offset, TransformNode node) {
+    // Meshes on a transform node damage the screen again every time the node moves
+    if (node == ATLAS_NO_TRANSFORM) {
+        Application::damage.addBounds(model, mesh.boundsMin + offset, mesh.boundsMax + offset);
+    }
+    else {
+        Application::damage.track(node, mesh.boundsMin + offset, mesh.boundsMax + offset);
+    }
+
+    size_t draw = submittedDraws.size();
+    if (program == 0) {
+        submittedDraws.push_back({mesh, Application::indirectBatch.add(mesh, offset, node)});
+        return draw;
+    }
+
+    submittedDraws.push_back({mesh, SIZE_MAX});
+    Application::renderFunctions.add_function([this, draw, program, offset, node]() {
+        drawMesh(submittedDraws[draw].mesh, program, offset, node);
+    });
+    return draw;
+}
+
+void RenderInstance::replaceMesh(size_t draw, const CoreMesh& mesh) {
+    SubmittedDraw& submitted = submittedDraws[draw];
+    submitted.mesh = mesh;
+    if (submitted.command != SIZE_MAX) {
+        Application::indirectBatch.replace(submitted.command, mesh);
+    }
+}
+
+bool RenderInstance::usesIndirectBatch(const Shader& shader) const {
+    // On OpenGL 4.5 meshes using the default shader are pooled and drawn by the indirect batch
+    return directStateAccess && !shader.isLocal && shader.type == AtlasShader::Default;
+}
+
+void RenderInstance::beginFrame(const DamageRect& region) {
+    // The scene framebuffer is kept between frames, only the damaged region is cleared and drawn again
+    glBindFramebuffer(GL_FRAMEBUFFER, sceneFramebuffer);
+    glViewport(0, 0, Application::width, Application::height);
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(region.x, region.y, region.width, region.height);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
+void RenderInstance::endFrame(const std::vector<DamageRect>& regions) {
+    if (postProcessDirty) {
+        buildPostProcessPasses();
+    }
 
-            std::string atlasShaderSource;
-            std::getline(atlasShaderPath, atlasShaderSource);
+    // Passes before the last redo the damaged regions, grown by how far the passes after them
+    // still spread each pixel. The last pass draws the whole screen, whose contents are lost on swap
+    int padding = 0;
+    for (const PostProcessPass& pass : postProcessPasses) {
+        padding += getPassSpread(pass);
+    }
 
-            std::string fragmentRoute = atlasShaderSource + "post_processing/none/none.frag";
-            std::string vertexRoute = atlasShaderSource + "post_processing/none/none.vert";
+    screenRegion[0] = {0, 0, Application::width, Application::height};
+    GLuint texture = sceneTexture;
+    for (size_t i = 0; i < postProcessPasses.size(); i++) {
+        const PostProcessPass& pass = postProcessPasses[i];
+        padding -= getPassSpread(pass);
 
-            program = getProgramFromLocal(vertexRoute.c_str(), fragmentRoute.c_str());
-            break;
+        if (pass.kind == PostProcessPassKind::Blur) {
+            applyBlurEffect(pass, texture, regions, padding);
+        }
+        else if (i + 1 == postProcessPasses.size()) {
+            drawPostProcessPass(pass, texture, 0, screenRegion, 0);
         }
-        case AtlasPostProcessing::Blur:
-            applyBlurEffect(texture);
-            return;
-        default:
-            break;
+        else {
+            drawPostProcessPass(pass, texture, pass.framebuffer, regions, padding);
         }
+        texture = pass.texture;
     }
 
-    GLuint texLoc = glGetUniformLocation(program, "screenTexture");
-    if (texLoc != -1) {
-        glUniform1i(texLoc, 0);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, texture);
+    glDisable(GL_SCISSOR_TEST);
+}
+
+RenderInstance::PostProcessUnitAlias& RenderInstance::PostProcessUnitAlias::operator=(PostProcessUnit unit) {
+    owner.setPostProcess(std::move(unit));
+    return *this;
+}
+
+RenderInstance::PostProcessUnitAlias::operator PostProcessUnit() const {
+    const std::vector<PostProcessUnit>& chain = owner.getPostProcessChain();
+    return chain.empty() ? PostProcessUnit(AtlasPostProcessing::None) : chain.front();
+}
+
+void RenderInstance::setPostProcess(PostProcessUnit unit) {
+    postProcessChain.clear();
+    addPostProcess(std::move(unit));
+}
+
+void RenderInstance::addPostProcess(PostProcessUnit unit) {
+    if (unit.isLocal || unit.type != AtlasPostProcessing::None) {
+        postProcessChain.push_back(std::move(unit));
     }
+    postProcessSpread = ::getPostProcessSpread(postProcessChain);
+    postProcessDirty = true;
+    Application::damage.invalidate();
+}
+
+void RenderInstance::clearPostProcess() {
+    postProcessChain.clear();
+    postProcessSpread = 0;
+    postProcessDirty = true;
+    Application::damage.invalidate();
+}
 
-    if (quadVAO == 0) {
-        std::cout << "Creating quad" << std::endl;
-        float quadVertices[] = {
-            -1.0f, 1.0f, 0.0f, 1.0f,
-            -1.0f, -1.0f, 0.0f, 0.0f,
-            1.0f, -1.0f, 1.0f, 0.0f,
-            1.0f, 1.0f, 1.0f, 1.0f
-        };
-        glGenVertexArrays(1, &quadVAO);
-        glGenBuffers(1, &quadVBO);
-        glBindVertexArray(quadVAO);
-        glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), quadVertices, GL_STATIC_DRAW);
-
-        // Position attribute
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
-        // Texture coordinate attribute
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
+void RenderInstance::buildPostProcessPasses() {
+    for (PostProcessPass& pass : postProcessPasses) {
+        glDeleteFramebuffers(1, &pass.framebuffer);
+        glDeleteTextures(1, &pass.texture);
     }
+    postProcessPasses = planPostProcessPasses(postProcessChain);
 
-    glUseProgram(program);
+    std::ifstream quadVertexFile(getAtlasRoot() + "post_processing/none/none.vert");
+    std::string quadVertexSource((std::istreambuf_iterator<char>(quadVertexFile)), std::istreambuf_iterator<char>());
+
+    for (PostProcessPass& pass : postProcessPasses) {
+        std::string signature;
+        if (pass.kind == PostProcessPassKind::Fused) {
+            signature = getFusedSignature(postProcessChain, pass.units);
+        }
+        else if (pass.kind == PostProcessPassKind::Local) {
+            const PostProcessUnit& unit = postProcessChain[pass.units[0]];
+            signature = std::string("local:") + unit.vertexShader + "|" + unit.fragmentShader;
+        }
+        else {
+            continue;
+        }
+
+        auto found = postProcessPrograms.find(signature);
+        if (found != postProcessPrograms.end()) {
+            pass.program = found->second;
+        }
+        else {
+            if (pass.kind == PostProcessPassKind::Fused) {
+                pass.program = getProgramFromSource(quadVertexSource,
+                                                    generateFusedShader(postProcessChain, pass.units));
+            }
+            else {
+                const PostProcessUnit& unit = postProcessChain[pass.units[0]];
+                pass.program = getProgramFromLocal(unit.vertexShader, unit.fragmentShader);
+            }
+            postProcessPrograms.emplace(signature, pass.program);
+        }
+
+        if (pass.kind == PostProcessPassKind::Fused) {
+            for (size_t stage = 0; stage < pass.units.size(); stage++) {
+                std::string name = "stage" + std::to_string(stage) + "Params";
+                pass.parameterLocations.push_back(glGetUniformLocation(pass.program, name.c_str()));
+            }
+        }
+    }
+
+    bool blurs = false;
+    for (size_t i = 0; i + 1 < postProcessPasses.size(); i++) {
+        PostProcessPass& pass = postProcessPasses[i];
+        createTarget(Application::width, Application::height, pass.framebuffer, pass.texture);
+        blurs = blurs || pass.kind == PostProcessPassKind::Blur;
+    }
+
+    if (blurs && pongFramebuffers[0] == 0) {
+        createPongBuffers(Application::width, Application::height);
+    }
+    createQuad();
+    postProcessDirty = false;
+}
+
+void RenderInstance::createQuad() {
+    if (quadVAO != 0) {
+        return;
+    }
+
+    float quadVertices[] = {
+        -1.0f, 1.0f, 0.0f, 1.0f,
+        -1.0f, -1.0f, 0.0f, 0.0f,
+        1.0f, -1.0f, 1.0f, 0.0f,
+        1.0f, 1.0f, 1.0f, 1.0f
+    };
+
+    if (directStateAccess) {
+        glCreateBuffers(1, &quadVBO);
+        glNamedBufferStorage(quadVBO, sizeof(quadVertices), quadVertices, 0);
+
+        glCreateVertexArrays(1, &quadVAO);
+        glVertexArrayVertexBuffer(quadVAO, 0, quadVBO, 0, 4 * sizeof(float));
+        glVertexArrayAttribFormat(quadVAO, 0, 2, GL_FLOAT, GL_FALSE, 0);
+        glVertexArrayAttribFormat(quadVAO, 1, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float));
+        glVertexArrayAttribBinding(quadVAO, 0, 0);
+        glVertexArrayAttribBinding(quadVAO, 1, 0);
+        glEnableVertexArrayAttrib(quadVAO, 0);
+        glEnableVertexArrayAttrib(quadVAO, 1);
+        return;
+    }
+
+    glGenVertexArrays(1, &quadVAO);
+    glGenBuffers(1, &quadVBO);
     glBindVertexArray(quadVAO);
-    glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+    glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), quadVertices, GL_STATIC_DRAW);
+
+    // Position attribute
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+    // Texture coordinate attribute
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
+    glBindVertexArray(0);
 }
 
-void RenderInstance::createPongBuffers(int width, int height) {
-    glDeleteFramebuffers(2, framebuffers);
-    glDeleteTextures(2, textures);
+void RenderInstance::drawPostProcessPass(const PostProcessPass& pass, GLuint texture, GLuint framebuffer,
+                                         const std::vector<DamageRect>& regions, int padding) {
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glViewport(0, 0, Application::width, Application::height);
+
+    glUseProgram(pass.program);
+    glUniform1i(glGetUniformLocation(pass.program, "screenTexture"), 0);
+    for (size_t stage = 0; stage < pass.parameterLocations.size(); stage++) {
+        glUniform4fv(pass.parameterLocations[stage], 4, postProcessChain[pass.units[stage]].parameters.data());
+    }
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, texture);
+
+    glBindVertexArray(quadVAO);
+    glEnable(GL_SCISSOR_TEST);
+    for (const DamageRect& region : regions) {
+        DamageRect area = region.padded(padding, padding).clamped(Application::width, Application::height);
+        glScissor(area.x, area.y, area.width, area.height);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+    }
+    glBindVertexArray(0);
+}
 
-    glGenFramebuffers(1, &framebuffers[0]);
-    glGenFramebuffers(1, &framebuffers[1]);
-    glGenTextures(1, &textures[0]);
-    glGenTextures(1, &textures[1]);
+void RenderInstance::createTarget(int width, int height, GLuint& framebuffer, GLuint& texture) {
+    if (directStateAccess) {
+        // Immutable storage lets the compute blur bind the texture as an image
+        glCreateFramebuffers(1, &framebuffer);
+        glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+        glTextureStorage2D(texture, 1, GL_RGBA16F, width, height);
+        glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glNamedFramebufferTexture(framebuffer, GL_COLOR_ATTACHMENT0, texture, 0);
+        return;
+    }
+
+    glGenFramebuffers(1, &framebuffer);
+    glGenTextures(1, &texture);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void RenderInstance::createPongBuffers(int width, int height) {
+    glDeleteFramebuffers(2, pongFramebuffers);
+    glDeleteTextures(2, pongTextures);
 
     for (unsigned int i = 0; i < 2; i++) {
-        glBindFramebuffer(GL_FRAMEBUFFER, framebuffers[i]);
-        glBindTexture(GL_TEXTURE_2D, textures[i]);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textures[i], 0);
+        createTarget(width, height, pongFramebuffers[i], pongTextures[i]);
     }
 }
 
-void RenderInstance::applyBlurEffect(GLuint texture) {
+void RenderInstance::applyBlurEffect(const PostProcessPass& pass, GLuint texture,
+                                     const std::vector<DamageRect>& regions, int padding) {
     GLenum error;
     while ((error = glGetError()) != GL_NO_ERROR) {
         std::cerr << "OpenGL Error: " << error << std::endl;
     }
-    std::string home = std::getenv("HOME");
-    std::ifstream atlasShaderPath(home + "/.atlas");
-    if (!atlasShaderPath) {
-        throw std::runtime_error("Failed to open ~/.atlas");
+    if (directStateAccess) {
+        applyComputeBlurEffect(pass, texture, regions, padding);
+        return;
     }
+    if (blurProgram == 0) {
+        std::string fragmentRoute = getAtlasRoot() + "post_processing/blur/blur.frag";
+        std::string vertexRoute = getAtlasRoot() + "post_processing/blur/blur.vert";
 
-    std::string atlasShaderSource;
-    std::getline(atlasShaderPath, atlasShaderSource);
-
-    std::string fragmentRoute = atlasShaderSource + "post_processing/blur/blur.frag";
-    std::string vertexRoute = atlasShaderSource + "post_processing/blur/blur.vert";
-
-    GLuint program = getProgramFromLocal(vertexRoute.c_str(), fragmentRoute.c_str());
+        blurProgram = getProgramFromLocal(vertexRoute.c_str(), fragmentRoute.c_str());
+    }
+    GLuint program = blurProgram;
 
     glUseProgram(program);
 
@@ -295,35 +654,91 @@ void RenderInstance::applyBlurEffect(GLuint texture) {
 
     GLint horizontalLoc = glGetUniformLocation(program, "horizontal");
 
-    bool horizontal = true, first_iteration = true;
-    for (unsigned int i = 0; i < 10; i++) {
-        glBindFramebuffer(GL_FRAMEBUFFER, framebuffers[horizontal]);
+    // Iterations go through the pong buffers and the last one writes the pass result. Each one
+    // covers the regions grown by the radius of the iterations still to come along each axis
+    int horizontalLeft = (ATLAS_BLUR_ITERATIONS + 1) / 2;
+    int verticalLeft = ATLAS_BLUR_ITERATIONS / 2;
+    int target = 0;
+    bool horizontal = true;
+    glBindVertexArray(quadVAO);
+    glEnable(GL_SCISSOR_TEST);
+    for (int i = 0; i < ATLAS_BLUR_ITERATIONS; i++) {
+        bool last = i + 1 == ATLAS_BLUR_ITERATIONS;
+        horizontal ? horizontalLeft-- : verticalLeft--;
+
+        glBindFramebuffer(GL_FRAMEBUFFER, last ? pass.framebuffer : pongFramebuffers[target]);
         glViewport(0, 0, Application::width, Application::height);
-        glClear(GL_COLOR_BUFFER_BIT);
 
         glUniform1i(horizontalLoc, horizontal);
 
         glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, first_iteration ? texture : textures[!horizontal]);
+        glBindTexture(GL_TEXTURE_2D, texture);
 
-        // Render quad
-        glBindVertexArray(quadVAO);
-        glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+        for (const DamageRect& region : regions) {
+            DamageRect area = region.padded(padding + ATLAS_BLUR_RADIUS * horizontalLeft,
+                                            padding + ATLAS_BLUR_RADIUS * verticalLeft)
+                                  .clamped(Application::width, Application::height);
+            glScissor(area.x, area.y, area.width, area.height);
+            glClear(GL_COLOR_BUFFER_BIT);
+            glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+        }
 
+        texture = pongTextures[target];
+        target = !target;
         horizontal = !horizontal;
-        if (first_iteration)
-            first_iteration = false;
     }
 
-    // Copy result back to screen
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    glViewport(0, 0, Application::width, Application::height);
-    glClear(GL_COLOR_BUFFER_BIT);
+    glBindVertexArray(0);
+}
 
-    glUseProgram(program);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, textures[!horizontal]);
+void RenderInstance::applyComputeBlurEffect(const PostProcessPass& pass, GLuint texture,
+                                            const std::vector<DamageRect>& regions, int padding) {
+    if (computeBlurProgram == 0) {
+        std::string computeRoute = getAtlasRoot() + "post_processing/blur/blur.comp";
+        computeBlurProgram = getComputeProgramFromLocal(computeRoute.c_str());
+    }
 
-    glBindVertexArray(quadVAO);
-    glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+    glUseProgram(computeBlurProgram);
+    GLint horizontalLoc = glGetUniformLocation(computeBlurProgram, "horizontal");
+    GLint regionLoc = glGetUniformLocation(computeBlurProgram, "region");
+
+    // Same iterations and regions as the fragment blur; each work group filters a 256 texel
+    // segment of one row or column of a region
+    const int tile = 256;
+    int horizontalLeft = (ATLAS_BLUR_ITERATIONS + 1) / 2;
+    int verticalLeft = ATLAS_BLUR_ITERATIONS / 2;
+    int target = 0;
+    bool horizontal = true;
+    for (int i = 0; i < ATLAS_BLUR_ITERATIONS; i++) {
+        bool last = i + 1 == ATLAS_BLUR_ITERATIONS;
+        horizontal ? horizontalLeft-- : verticalLeft--;
+
+        glUniform1i(horizontalLoc, horizontal);
+        glBindTextureUnit(0, texture);
+        glBindImageTexture(0, last ? pass.texture : pongTextures[target], 0, GL_FALSE, 0, GL_WRITE_ONLY,
+                           GL_RGBA16F);
+
+        for (const DamageRect& region : regions) {
+            DamageRect area = region.padded(padding + ATLAS_BLUR_RADIUS * horizontalLeft,
+                                            padding + ATLAS_BLUR_RADIUS * verticalLeft)
+                                  .clamped(Application::width, Application::height);
+            if (area.empty()) {
+                continue;
+            }
+
+            glUniform4i(regionLoc, area.x, area.y, area.width, area.height);
+            if (horizontal) {
+                glDispatchCompute((area.width + tile - 1) / tile, area.height, 1);
+            }
+            else {
+                glDispatchCompute((area.height + tile - 1) / tile, area.width, 1);
+            }
+        }
+        // The next iteration, or the pass after the blur, samples what was just written
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+        texture = pongTextures[target];
+        target = !target;
+        horizontal = !horizontal;
+    }
 }
@@ -0,0 +1,195 @@
+/*
+* damage.cpp
+* As part of the Atlas project
+* Created by Maxims Enterprise in 2024
+* --------------------------------------
+* Description: Damaged screen regions between frames
+* Copyright (c) 2024 Maxims Enterprise
+*/
+
+#include <atlas/core/damage.h>
+#include "atlas/application.h"
+#include <algorithm>
+#include <cmath>
+
+DamageRect DamageRect::padded(int horizontal, int vertical) const {
+    return {x - horizontal, y - vertical, width + 2 * horizontal, height + 2 * vertical};
+}
+
+DamageRect DamageRect::clamped(int screenWidth, int screenHeight) const {
+    int left = std::max(x, 0);
+    int bottom = std::max(y, 0);
+    int right = std::min(x + width, screenWidth);
+    int top = std::min(y + height, screenHeight);
+    return {left, bottom, right - left, top - bottom};
+}
+
+DamageRect DamageRect::merged(const DamageRect& other) const {
+    int left = std::min(x, other.x);
+    int bottom = std::min(y, other.y);
+    int right = std::max(x + width, other.x + other.width);
+    int top = std::max(y + height, other.y + other.height);
+    return {left, bottom, right - left, top - bottom};
+}
+
+bool DamageRect::overlaps(const DamageRect& other) const {
+    return x < other.x + other.width && other.x < x + width && y < other.y + other.height && other.y < y + height;
+}
+
+void DamageTracker::add(DamageRect rect) {
+    if (!full && !rect.empty()) {
+        rects.push_back(rect);
+    }
+}
+
+bool DamageTracker::project(const glm::mat4& transform, glm::vec3 min, glm::vec3 max, DamageRect& rect) const {
+    glm::mat4 clip = RenderInstance::projection * RenderInstance::view * transform;
+    glm::vec2 low(INFINITY);
+    glm::vec2 high(-INFINITY);
+
+    for (int corner = 0; corner < 8; corner++) {
+        glm::vec4 point(corner & 1 ? max.x : min.x, corner & 2 ? max.y : min.y, corner & 4 ? max.z : min.z, 1.0f);
+        glm::vec4 projected = clip * point;
+        // Boxes crossing the camera plane have no bounded screen area
+        if (projected.w <= 0.0f) {
+            return false;
+        }
+        glm::vec2 ndc(projected.x / projected.w, projected.y / projected.w);
+        low = glm::min(low, ndc);
+        high = glm::max(high, ndc);
+    }
+
+    // One extra pixel on each side covers rasterization and filtering at the edges
+    int left = static_cast<int>(std::floor((low.x * 0.5f + 0.5f) * Application::width)) - 1;
+    int bottom = static_cast<int>(std::floor((low.y * 0.5f + 0.5f) * Application::height)) - 1;
+    int right = static_cast<int>(std::ceil((high.x * 0.5f + 0.5f) * Application::width)) + 1;
+    int top = static_cast<int>(std::ceil((high.y * 0.5f + 0.5f) * Application::height)) + 1;
+    rect = {left, bottom, right - left, top - bottom};
+    return true;
+}
+
+void DamageTracker::addBounds(const glm::mat4& transform, glm::vec3 min, glm::vec3 max) {
+    if (full) {
+        return;
+    }
+
+    DamageRect rect;
+    if (project(transform, min, max, rect)) {
+        add(rect);
+    }
+    else {
+        invalidate();
+    }
+}
+
+void DamageTracker::invalidate() {
+    full = true;
+    rects.clear();
+}
+
+DamageRect DamageTracker::projectTracked(const TrackedBounds& bounds) {
+    DamageRect rect;
+    glm::mat4 transform = RenderInstance::model * Application::transforms.getWorld(bounds.node);
+    if (!project(transform, bounds.min, bounds.max, rect)) {
+        invalidate();
+        return {};
+    }
+    return rect;
+}
+
+void DamageTracker::track(TransformNode node, glm::vec3 min, glm::vec3 max) {
+    if (trackedByNode.size() <= static_cast<size_t>(node)) {
+        trackedByNode.resize(node + 1);
+    }
+    trackedByNode[node].push_back(tracked.size());
+
+    TrackedBounds bounds{node, min, max, {}};
+    bounds.last = projectTracked(bounds);
+    add(bounds.last);
+    tracked.push_back(bounds);
+}
+
+void DamageTracker::nodesMoved(const std::vector<TransformNode>& nodes) {
+    for (TransformNode node : nodes) {
+        if (static_cast<size_t>(node) >= trackedByNode.size()) {
+            continue;
+        }
+        for (size_t index : trackedByNode[node]) {
+            TrackedBounds& bounds = tracked[index];
+            add(bounds.last);
+            bounds.last = projectTracked(bounds);
+            add(bounds.last);
+        }
+    }
+}
+
+bool DamageTracker::checkMatrices() {
+    if (RenderInstance::model == lastModel && RenderInstance::view == lastView &&
+        RenderInstance::projection == lastProjection) {
+        return false;
+    }
+
+    lastModel = RenderInstance::model;
+    lastView = RenderInstance::view;
+    lastProjection = RenderInstance::projection;
+    invalidate();
+
+    // Every tracked shape moved on screen, its remembered area has to follow
+    for (TrackedBounds& bounds : tracked) {
+        bounds.last = projectTracked(bounds);
+    }
+    return true;
+}
+
+const std::vector<DamageRect>& DamageTracker::collect(int padding, int screenWidth, int screenHeight) {
+    regions.clear();
+    DamageRect screen{0, 0, screenWidth, screenHeight};
+
+    if (full || padding < 0) {
+        regions.push_back(screen);
+        clear();
+        return regions;
+    }
+
+    DamageRect bounding;
+    for (const DamageRect& rect : rects) {
+        DamageRect region = rect.padded(padding, padding).clamped(screenWidth, screenHeight);
+        if (!region.empty()) {
+            bounding = regions.empty() ? region : bounding.merged(region);
+            regions.push_back(region);
+        }
+    }
+    rects.clear();
+
+    // Merging is quadratic, large batches of damage go straight to their bounding rectangle
+    if (regions.size() > maxRegions * 16) {
+        regions.assign(1, bounding);
+        return regions;
+    }
+
+    // Overlapping regions would redraw the same pixels once for each of them
+    bool mergedAny = true;
+    while (mergedAny) {
+        mergedAny = false;
+        for (size_t i = 0; i < regions.size() && !mergedAny; i++) {
+            for (size_t j = i + 1; j < regions.size(); j++) {
+                if (regions[i].overlaps(regions[j])) {
+                    regions[i] = regions[i].merged(regions[j]);
+                    regions.erase(regions.begin() + static_cast<std::ptrdiff_t>(j));
+                    mergedAny = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    if (regions.size() > maxRegions) {
+        regions.assign(1, bounding);
+    }
+    return regions;
+}
+
+void DamageTracker::clear() {
+    rects.clear();
+    full = false;
+}
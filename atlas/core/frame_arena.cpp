@@ -0,0 +1,66 @@
+/*
+* frame_arena.cpp
+* As part of the Atlas project
+* Created by Maxims Enterprise in 2024
+* --------------------------------------
+* Description: Per-frame linear allocator for transient render data
+* Copyright (c) 2024 Maxims Enterprise
+*/
+
+#include <atlas/core/frame_arena.h>
+#include <algorithm>
+#include <cstdint>
+
+FrameArena::FrameArena(size_t capacity) : block(std::make_unique_for_overwrite<std::byte[]>(capacity)),
+                                          capacityBytes(capacity) {
+    heapAllocationCount++;
+}
+
+void* FrameArena::allocate(size_t size, size_t alignment) {
+    uintptr_t base = reinterpret_cast<uintptr_t>(block.get());
+    uintptr_t aligned = (base + offset + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1);
+    size_t end = aligned - base + size;
+
+    if (end <= capacityBytes) {
+        offset = end;
+        return reinterpret_cast<void*>(aligned);
+    }
+
+    // Out of space for this frame: fall back to the heap and remember how much was needed
+    overflow.push_back(std::make_unique_for_overwrite<std::byte[]>(size + alignment));
+    heapAllocationCount++;
+    overflowBytes += size + alignment;
+
+    uintptr_t overflowBase = reinterpret_cast<uintptr_t>(overflow.back().get());
+    return reinterpret_cast<void*>((overflowBase + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1));
+}
+
+void FrameArena::reset() {
+    peakBytes = std::max(peakBytes, used());
+
+    if (!overflow.empty()) {
+        overflow.clear();
+        capacityBytes = std::max(peakBytes, capacityBytes + capacityBytes / 2);
+        block = std::make_unique_for_overwrite<std::byte[]>(capacityBytes);
+        heapAllocationCount++;
+    }
+
+    offset = 0;
+    overflowBytes = 0;
+}
+
+size_t FrameArenaRing::peak() const {
+    size_t result = 0;
+    for (const FrameArena& arena : arenas) {
+        result = std::max(result, arena.peak());
+    }
+    return result;
+}
+
+size_t FrameArenaRing::heapAllocations() const {
+    size_t result = 0;
+    for (const FrameArena& arena : arenas) {
+        result += arena.heapAllocations();
+    }
+    return result;
+}
@@ -0,0 +1,168 @@
+/*
+* indirect_batch.cpp
+* As part of the Atlas project
+* Created by Maxims Enterprise in 2024
+* --------------------------------------
+* Description: Pooled meshes drawn with multi-draw indirect on OpenGL 4.5
+* Copyright (c) 2024 Maxims Enterprise
+*/
+
+#include <atlas/core/indirect_batch.h>
+#include <atlas/application.h>
+#include <algorithm>
+#include <glm/gtc/type_ptr.hpp>
+
+void IndirectMeshBatch::createVertexArray() {
+    glCreateVertexArrays(1, &vao);
+
+    // Binding 0 holds the pooled vertices, binding 1 one IndirectDrawData per draw
+    glVertexArrayAttribFormat(vao, 0, 3, GL_FLOAT, GL_FALSE, offsetof(CoreVertex, position));
+    glVertexArrayAttribFormat(vao, 1, 4, GL_FLOAT, GL_FALSE, offsetof(CoreVertex, color));
+    glVertexArrayAttribFormat(vao, 2, 4, GL_FLOAT, GL_FALSE, 0);
+    glVertexArrayAttribBinding(vao, 0, 0);
+    glVertexArrayAttribBinding(vao, 1, 0);
+    glVertexArrayAttribBinding(vao, 2, 1);
+    glVertexArrayBindingDivisor(vao, 1, 1);
+    glEnableVertexArrayAttrib(vao, 0);
+    glEnableVertexArrayAttrib(vao, 1);
+    glEnableVertexArrayAttrib(vao, 2);
+
+    // Meshes drawn with their own shader also use this vertex array, before any indirect draw
+    // may have filled binding 1. It starts with one neutral entry so the attribute is always backed
+    IndirectDrawData neutral{glm::vec3(0.0f), static_cast<float>(ATLAS_NO_TRANSFORM)};
+    reserve(drawBuffer, drawCapacity, 0, 1, sizeof(IndirectDrawData));
+    glNamedBufferSubData(drawBuffer, 0, sizeof(neutral), &neutral);
+    glVertexArrayVertexBuffer(vao, 1, drawBuffer, 0, sizeof(IndirectDrawData));
+}
+
+void IndirectMeshBatch::reserve(GLuint& buffer, size_t& capacity, size_t used, size_t needed, size_t elementSize) {
+    if (needed <= capacity) {
+        return;
+    }
+
+    // Immutable storage cannot be resized, so a bigger buffer takes over the old contents
+    size_t newCapacity = std::max<size_t>(needed, std::max<size_t>(capacity * 2, 1024));
+    GLuint newBuffer;
+    glCreateBuffers(1, &newBuffer);
+    glNamedBufferStorage(newBuffer, newCapacity * elementSize, nullptr, GL_DYNAMIC_STORAGE_BIT);
+    if (buffer != 0) {
+        glCopyNamedBufferSubData(buffer, newBuffer, 0, 0, used * elementSize);
+        glDeleteBuffers(1, &buffer);
+    }
+
+    buffer = newBuffer;
+    capacity = newCapacity;
+}
+
+CoreMesh IndirectMeshBatch::allocate(const CoreVertex* vertices, size_t vertexCount, const GLuint* indices,
+                                     size_t indexCount, GLenum mode) {
+    if (vao == 0) {
+        createVertexArray();
+    }
+
+    reserve(vertexBuffer, vertexCapacity, verticesUsed, verticesUsed + vertexCount, sizeof(CoreVertex));
+    reserve(indexBuffer, indexCapacity, indicesUsed, indicesUsed + indexCount, sizeof(GLuint));
+    glVertexArrayVertexBuffer(vao, 0, vertexBuffer, 0, sizeof(CoreVertex));
+    glVertexArrayElementBuffer(vao, indexBuffer);
+
+    glNamedBufferSubData(vertexBuffer, verticesUsed * sizeof(CoreVertex), vertexCount * sizeof(CoreVertex),
+                         vertices);
+    glNamedBufferSubData(indexBuffer, indicesUsed * sizeof(GLuint), indexCount * sizeof(GLuint), indices);
+
+    CoreMesh mesh;
+    mesh.vao = vao;
+    mesh.vbo = vertexBuffer;
+    mesh.ebo = indexBuffer;
+    mesh.indexCount = static_cast<GLsizei>(indexCount);
+    mesh.mode = mode;
+    mesh.firstIndex = static_cast<GLuint>(indicesUsed);
+    mesh.baseVertex = static_cast<GLint>(verticesUsed);
+    mesh.pooled = true;
+
+    verticesUsed += vertexCount;
+    indicesUsed += indexCount;
+    return mesh;
+}
+
+size_t IndirectMeshBatch::add(const CoreMesh& mesh, glm::vec3 offset, TransformNode node) {
+    // Nothing depth tests, so a shape queued in between must still be drawn between the two runs
+    if (runs.empty() || Application::renderFunctions.size() != queuedFunctions) {
+        size_t run = runs.size();
+        runs.push_back({commands.size(), 0});
+        Application::renderFunctions.add_function([this, run, runGeneration = generation]() {
+            draw(run, runGeneration);
+        });
+        queuedFunctions = Application::renderFunctions.size();
+    }
+    runs.back().commandCount++;
+
+    // baseInstance picks the draw data of this command from the instanced attribute
+    commands.push_back({static_cast<GLuint>(mesh.indexCount), 1, mesh.firstIndex, mesh.baseVertex,
+                        static_cast<GLuint>(draws.size())});
+    draws.push_back({offset, static_cast<float>(node)});
+    dirty = true;
+    return commands.size() - 1;
+}
+
+void IndirectMeshBatch::replace(size_t command, const CoreMesh& mesh) {
+    DrawElementsIndirectCommand& replaced = commands[command];
+    replaced.count = static_cast<GLuint>(mesh.indexCount);
+    replaced.firstIndex = mesh.firstIndex;
+    replaced.baseVertex = mesh.baseVertex;
+    dirty = true;
+}
+
+void IndirectMeshBatch::draw(size_t run, unsigned int runGeneration) {
+    // Runs queued before the batch was cleared have nothing left to draw
+    if (runGeneration != generation || run >= runs.size()) {
+        return;
+    }
+
+    if (dirty) {
+        reserve(commandBuffer, commandCapacity, 0, commands.size(), sizeof(DrawElementsIndirectCommand));
+        reserve(drawBuffer, drawCapacity, 0, draws.size(), sizeof(IndirectDrawData));
+
+        glNamedBufferSubData(commandBuffer, 0, commands.size() * sizeof(DrawElementsIndirectCommand), commands.data());
+        glNamedBufferSubData(drawBuffer, 0, draws.size() * sizeof(IndirectDrawData), draws.data());
+        glVertexArrayVertexBuffer(vao, 1, drawBuffer, 0, sizeof(IndirectDrawData));
+        dirty = false;
+    }
+
+    if (program == 0) {
+        std::string vertexRoute = RenderInstance::getAtlasRoot() + "shaders/normal/normal_indirect.vert";
+        std::string fragmentRoute = RenderInstance::getAtlasRoot() + "shaders/normal/normal.frag";
+        program = Application::instance.getProgramFromLocal(vertexRoute.c_str(), fragmentRoute.c_str());
+    }
+
+    glUseProgram(program);
+    glUniformMatrix4fv(glGetUniformLocation(program, "model"), 1, GL_FALSE, glm::value_ptr(RenderInstance::model));
+    glUniformMatrix4fv(glGetUniformLocation(program, "view"), 1, GL_FALSE, glm::value_ptr(RenderInstance::view));
+    glUniformMatrix4fv(glGetUniformLocation(program, "projection"), 1, GL_FALSE,
+                       glm::value_ptr(RenderInstance::projection));
+    glUniform1i(glGetUniformLocation(program, "transforms"), 1);
+    glBindTextureUnit(1, Application::transforms.getTexture());
+
+    glBindVertexArray(vao);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+    const DrawRun& commandRun = runs[run];
+    glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+                                (void*)(commandRun.firstCommand * sizeof(DrawElementsIndirectCommand)),
+                                static_cast<GLsizei>(commandRun.commandCount), 0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    glBindVertexArray(0);
+}
+
+void IndirectMeshBatch::clear() {
+    GLuint buffers[] = {vertexBuffer, indexBuffer, drawBuffer, commandBuffer};
+    glDeleteBuffers(4, buffers);
+    glDeleteVertexArrays(1, &vao);
+    glDeleteProgram(program);
+    vao = vertexBuffer = indexBuffer = drawBuffer = commandBuffer = program = 0;
+    vertexCapacity = verticesUsed = indexCapacity = indicesUsed = commandCapacity = drawCapacity = 0;
+    commands.clear();
+    draws.clear();
+    runs.clear();
+    queuedFunctions = 0;
+    generation++;
+    dirty = false;
+}
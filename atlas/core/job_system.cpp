@@ -0,0 +1,259 @@
+/*
+* job_system.cpp
+* As part of the Atlas project
+* Created by Maxims Enterprise in 2024
+* --------------------------------------
+* Description: Work-stealing job system shared by the engine and its users
+* Copyright (c) 2024 Maxims Enterprise
+*/
+
+#include <atlas/core/job_system.h>
+
+// Identifies the worker running on this thread, so that jobs it submits go to its own queue
+static thread_local const JobSystem* currentSystem = nullptr;
+static thread_local unsigned int currentIndex = 0;
+
+JobSystem::JobSystem(unsigned int workerCount) : workerCount(workerCount) {
+    if (this->workerCount == 0) {
+        unsigned int hardware = std::thread::hardware_concurrency();
+        this->workerCount = hardware > 1 ? hardware - 1 : 1;
+    }
+
+    for (unsigned int i = 0; i <= this->workerCount; i++) {
+        queues.push_back(std::make_unique<WorkQueue>());
+    }
+    for (unsigned int i = 0; i < this->workerCount; i++) {
+        counters.push_back(std::make_unique<WorkerCounters>());
+    }
+}
+
+JobSystem::~JobSystem() {
+    shutdown();
+}
+
+void JobSystem::start() {
+    std::lock_guard lock(startMutex);
+    if (started || stopping) {
+        return;
+    }
+
+    statsStart = std::chrono::steady_clock::now();
+    for (unsigned int i = 0; i < workerCount; i++) {
+        workers.emplace_back(&JobSystem::workerLoop, this, i);
+    }
+    started = true;
+}
+
+void JobSystem::shutdown() {
+    {
+        std::lock_guard lock(sleepMutex);
+        stopping = true;
+    }
+    sleepCondition.notify_all();
+
+    {
+        std::lock_guard lock(startMutex);
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+        workers.clear();
+    }
+
+    // Jobs queued while the workers were stopping still run here, so every counter reaches zero
+    for (auto& queue : queues) {
+        while (true) {
+            Job job;
+            {
+                std::lock_guard lock(queue->mutex);
+                if (!queue->popOldest(job, nullptr)) {
+                    break;
+                }
+            }
+            job.function();
+            if (job.counter) {
+                job.counter->fetch_sub(1, std::memory_order_release);
+            }
+        }
+    }
+    queuedJobs = 0;
+}
+
+void JobSystem::submit(std::function<void()> job, JobCounter* counter) {
+    if (!started && !stopping) {
+        start();
+    }
+
+    // Shutdown drains the queues after setting stopping, so checking it under the queue lock
+    // means the job is either drained there or, once the workers are gone, run on the caller
+    WorkQueue& queue = *queues[currentQueue()];
+    bool queued = false;
+    {
+        std::lock_guard lock(queue.mutex);
+        if (!stopping) {
+            if (counter) {
+                counter->fetch_add(1, std::memory_order_relaxed);
+            }
+            queue.push({std::move(job), counter});
+            queued = true;
+        }
+    }
+    if (!queued) {
+        job();
+        return;
+    }
+    queuedJobs.fetch_add(1, std::memory_order_release);
+
+    {
+        std::lock_guard lock(sleepMutex);
+    }
+    sleepCondition.notify_one();
+}
+
+void JobSystem::wait(JobCounter& counter) {
+    // The waiting thread helps with the remaining jobs of its group instead of blocking
+    unsigned int self = currentQueue();
+    while (counter.load(std::memory_order_acquire) > 0) {
+        if (!runOne(self, &counter)) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+unsigned int JobSystem::currentQueue() const {
+    return currentSystem == this ? currentIndex : workerCount;
+}
+
+void JobSystem::WorkQueue::push(Job job) {
+    if (count == slots.size()) {
+        std::vector<Job> grown(std::max<size_t>(slots.size() * 2, 64));
+        for (size_t i = 0; i < count; i++) {
+            grown[i] = std::move(slots[(head + i) % slots.size()]);
+        }
+        slots = std::move(grown);
+        head = 0;
+    }
+    slots[(head + count) % slots.size()] = std::move(job);
+    count++;
+}
+
+bool JobSystem::WorkQueue::popNewest(Job& job, const JobCounter* only) {
+    for (size_t i = count; i-- > 0;) {
+        Job& candidate = slots[(head + i) % slots.size()];
+        if (only && candidate.counter != only) {
+            continue;
+        }
+
+        // Newer jobs move down to close the gap
+        job = std::move(candidate);
+        for (size_t j = i; j + 1 < count; j++) {
+            slots[(head + j) % slots.size()] = std::move(slots[(head + j + 1) % slots.size()]);
+        }
+        count--;
+        return true;
+    }
+    return false;
+}
+
+bool JobSystem::WorkQueue::popOldest(Job& job, const JobCounter* only) {
+    for (size_t i = 0; i < count; i++) {
+        Job& candidate = slots[(head + i) % slots.size()];
+        if (only && candidate.counter != only) {
+            continue;
+        }
+
+        // Older jobs move up to close the gap
+        job = std::move(candidate);
+        for (size_t j = i; j > 0; j--) {
+            slots[(head + j) % slots.size()] = std::move(slots[(head + j - 1) % slots.size()]);
+        }
+        head = (head + 1) % slots.size();
+        count--;
+        return true;
+    }
+    return false;
+}
+
+bool JobSystem::runOne(unsigned int self, const JobCounter* only) {
+    Job job;
+    bool found = false;
+    bool stolen = false;
+
+    {
+        WorkQueue& own = *queues[self];
+        std::lock_guard lock(own.mutex);
+        found = own.popNewest(job, only);
+    }
+
+    for (unsigned int offset = 1; !found && offset < queues.size(); offset++) {
+        WorkQueue& victim = *queues[(self + offset) % queues.size()];
+        std::lock_guard lock(victim.mutex);
+        found = stolen = victim.popOldest(job, only);
+    }
+
+    if (!found) {
+        return false;
+    }
+    queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+
+    auto start = std::chrono::steady_clock::now();
+    job.function();
+    if (job.counter) {
+        job.counter->fetch_sub(1, std::memory_order_release);
+    }
+
+    if (self < workerCount) {
+        WorkerCounters& stats = *counters[self];
+        stats.jobsExecuted.fetch_add(1, std::memory_order_relaxed);
+        if (stolen) {
+            stats.jobsStolen.fetch_add(1, std::memory_order_relaxed);
+        }
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+        stats.busyNanoseconds.fetch_add(elapsed.count(), std::memory_order_relaxed);
+    }
+    return true;
+}
+
+void JobSystem::workerLoop(unsigned int index) {
+    currentSystem = this;
+    currentIndex = index;
+
+    while (true) {
+        if (runOne(index, nullptr)) {
+            continue;
+        }
+
+        std::unique_lock lock(sleepMutex);
+        sleepCondition.wait(lock, [this]() {
+            return stopping || queuedJobs.load(std::memory_order_acquire) > 0;
+        });
+        if (stopping) {
+            return;
+        }
+    }
+}
+
+std::vector<JobWorkerStats> JobSystem::getStats() const {
+    double elapsed = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - statsStart).count());
+
+    std::vector<JobWorkerStats> stats;
+    stats.reserve(counters.size());
+    for (const auto& worker : counters) {
+        double busy = static_cast<double>(worker->busyNanoseconds.load(std::memory_order_relaxed));
+        stats.push_back({
+            worker->jobsExecuted.load(std::memory_order_relaxed),
+            worker->jobsStolen.load(std::memory_order_relaxed),
+            elapsed > 0.0 ? busy / elapsed : 0.0,
+        });
+    }
+    return stats;
+}
+
+void JobSystem::resetStats() {
+    for (auto& worker : counters) {
+        worker->jobsExecuted = 0;
+        worker->jobsStolen = 0;
+        worker->busyNanoseconds = 0;
+    }
+    statsStart = std::chrono::steady_clock::now();
+}
@@ -0,0 +1,133 @@
+/*
+* post_processing.cpp
+* As part of the Atlas project
+* Created by Maxims Enterprise in 2024
+* --------------------------------------
+* Description: Post-processing chains and pass fusion
+* Copyright (c) 2024 Maxims Enterprise
+*/
+
+#include <atlas/core/post_processing.h>
+
+static const char* getPointwiseSnippet(const PostProcessUnit& unit) {
+    switch (unit.type) {
+    case AtlasPostProcessing::InvertAllColors:
+        return "color.rgb = 1.0 - color.rgb;";
+    case AtlasPostProcessing::Tint:
+        return "color.rgb *= params[0].rgb;";
+    case AtlasPostProcessing::Gamma:
+        return "color.rgb = pow(max(color.rgb, vec3(0.0)), vec3(1.0 / params[0].x));";
+    case AtlasPostProcessing::ColorGrade:
+        return "color.rgb = mat3(params[0].rgb, params[1].rgb, params[2].rgb) * color.rgb + params[3].rgb;";
+    case AtlasPostProcessing::Custom:
+        return unit.snippet.c_str();
+    default:
+        return "";
+    }
+}
+
+static const char* getEffectName(AtlasPostProcessing type) {
+    switch (type) {
+    case AtlasPostProcessing::InvertAllColors:
+        return "invert";
+    case AtlasPostProcessing::Tint:
+        return "tint";
+    case AtlasPostProcessing::Gamma:
+        return "gamma";
+    case AtlasPostProcessing::ColorGrade:
+        return "grade";
+    default:
+        return "custom";
+    }
+}
+
+static PostProcessPass makePass(PostProcessPassKind kind) {
+    PostProcessPass pass;
+    pass.kind = kind;
+    return pass;
+}
+
+std::vector<PostProcessPass> planPostProcessPasses(const std::vector<PostProcessUnit>& chain) {
+    std::vector<PostProcessPass> passes;
+
+    for (size_t i = 0; i < chain.size(); i++) {
+        const PostProcessUnit& unit = chain[i];
+        if (unit.isPointwise()) {
+            if (passes.empty() || passes.back().kind != PostProcessPassKind::Fused) {
+                passes.push_back(makePass(PostProcessPassKind::Fused));
+            }
+            passes.back().units.push_back(i);
+        }
+        else if (unit.isLocal) {
+            passes.push_back(makePass(PostProcessPassKind::Local));
+            passes.back().units.push_back(i);
+        }
+        else if (unit.type == AtlasPostProcessing::Blur) {
+            passes.push_back(makePass(PostProcessPassKind::Blur));
+            passes.back().units.push_back(i);
+        }
+    }
+
+    // An empty fused pass is a plain copy to the screen
+    if (passes.empty() || passes.back().kind == PostProcessPassKind::Blur) {
+        passes.push_back(makePass(PostProcessPassKind::Fused));
+    }
+    return passes;
+}
+
+int getPassSpread(const PostProcessPass& pass) {
+    // Each axis is only spread by the iterations running along it
+    if (pass.kind == PostProcessPassKind::Blur) {
+        return ATLAS_BLUR_RADIUS * ((ATLAS_BLUR_ITERATIONS + 1) / 2);
+    }
+    return 0;
+}
+
+int getPostProcessSpread(const std::vector<PostProcessUnit>& chain) {
+    int spread = 0;
+    for (const PostProcessPass& pass : planPostProcessPasses(chain)) {
+        // Shaders from files may sample anywhere
+        if (pass.kind == PostProcessPassKind::Local) {
+            return -1;
+        }
+        spread += getPassSpread(pass);
+    }
+    return spread;
+}
+
+std::string getFusedSignature(const std::vector<PostProcessUnit>& chain, const std::vector<size_t>& units) {
+    std::string signature;
+    for (size_t unit : units) {
+        signature += getEffectName(chain[unit].type);
+        if (chain[unit].type == AtlasPostProcessing::Custom) {
+            signature += "{" + chain[unit].snippet + "}";
+        }
+        signature += ";";
+    }
+    return signature;
+}
+
+std::string generateFusedShader(const std::vector<PostProcessUnit>& chain, const std::vector<size_t>& units) {
+    std::string source =
+        "#version 330 core\n"
+        "in vec2 TexCoords;\n"
+        "out vec4 FragColor;\n"
+        "uniform sampler2D screenTexture;\n";
+
+    // Every effect becomes a function, so snippets cannot see each other's variables
+    for (size_t stage = 0; stage < units.size(); stage++) {
+        std::string name = "stage" + std::to_string(stage);
+        source += "uniform vec4 " + name + "Params[4];\n";
+        source += "vec4 " + name + "(vec4 color, vec4 params[4]) {\n    ";
+        source += getPointwiseSnippet(chain[units[stage]]);
+        source += "\n    return color;\n}\n";
+    }
+
+    source += "void main() {\n    vec4 color = texture(screenTexture, TexCoords);\n";
+    for (size_t stage = 0; stage < units.size(); stage++) {
+        std::string name = "stage" + std::to_string(stage);
+        source += "    color = " + name + "(color, " + name + "Params);\n";
+    }
+    source += "    FragColor = color;\n}\n";
+    return source;
+}
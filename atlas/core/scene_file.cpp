@@ -0,0 +1,363 @@
+/*
+* scene_file.cpp
+* As part of the Atlas project
+* Created by Maxims Enterprise in 2024
+* --------------------------------------
+* Description: Baked scene files mapped straight into GPU buffers
+* Copyright (c) 2024 Maxims Enterprise
+*/
+
+#include <atlas/core/scene_file.h>
+#include "atlas/application.h"
+#include "atlas/shape.h"
+#include <fstream>
+#include <iostream>
+#include <cstring>
+#include <stdexcept>
+#include <glm/gtc/type_ptr.hpp>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define ATLAS_SCENE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static_assert(sizeof(glm::mat4) == sizeof(SceneNodeRecord::local), "Node matrices are stored as 16 floats");
+
+void SceneBaker::add(const Primitive& primitive) {
+    addShape(primitive.name, primitive.tessellated(), primitive.shader,
+             primitive.position.toVec3(), primitive.node);
+}
+
+void SceneBaker::add(const Triangle& triangle) {
+    CoreGeometry geometry{triangle.vertices, {0, 1, 2}};
+    addShape(triangle.name, geometry, triangle.shader, glm::vec3(0.0f), ATLAS_NO_TRANSFORM);
+}
+
+void SceneBaker::add(const std::string& name, const CoreGeometry& geometry, Shader shader) {
+    addShape(name, geometry, shader, glm::vec3(0.0f), ATLAS_NO_TRANSFORM);
+}
+
+void SceneBaker::addShape(const std::string& name, const CoreGeometry& geometry, const Shader& shader,
+                          glm::vec3 offset, TransformNode node) {
+    CoreMesh bounds;
+    computeBounds(geometry, bounds);
+
+    SceneShapeRecord shape{};
+    shape.name = addString(name);
+    shape.program = addProgram(shader);
+    shape.mode = GL_TRIANGLES;
+    shape.firstIndex = static_cast<uint32_t>(indices.size());
+    shape.baseVertex = static_cast<int32_t>(vertices.size());
+    shape.vertexCount = static_cast<uint32_t>(geometry.vertices.size());
+    shape.indexCount = static_cast<uint32_t>(geometry.indices.size());
+    shape.node = node;
+    std::memcpy(shape.offset, glm::value_ptr(offset), sizeof(shape.offset));
+    std::memcpy(shape.boundsMin, glm::value_ptr(bounds.boundsMin), sizeof(shape.boundsMin));
+    std::memcpy(shape.boundsMax, glm::value_ptr(bounds.boundsMax), sizeof(shape.boundsMax));
+    shapes.push_back(shape);
+
+    vertices.insert(vertices.end(), geometry.vertices.begin(), geometry.vertices.end());
+    indices.insert(indices.end(), geometry.indices.begin(), geometry.indices.end());
+    usesTransforms = usesTransforms || node != ATLAS_NO_TRANSFORM;
+}
+
+uint32_t SceneBaker::addProgram(const Shader& shader) {
+    std::string key = shader.isLocal
+                          ? std::string("local:") + shader.vertexShader + "|" + shader.fragmentShader
+                          : "builtin:" + std::to_string(static_cast<uint32_t>(shader.type));
+    for (size_t i = 0; i < programKeys.size(); i++) {
+        if (programKeys[i] == key) {
+            return static_cast<uint32_t>(i);
+        }
+    }
+
+    SceneProgramRecord program{};
+    program.local = shader.isLocal;
+    program.shader = static_cast<uint32_t>(shader.type);
+    if (shader.isLocal) {
+        program.vertexPath = addString(shader.vertexShader);
+        program.fragmentPath = addString(shader.fragmentShader);
+    }
+    programs.push_back(program);
+    programKeys.push_back(key);
+    return static_cast<uint32_t>(programs.size() - 1);
+}
+
+uint32_t SceneBaker::addString(const std::string& string) {
+    uint32_t offset = static_cast<uint32_t>(strings.size());
+    strings += string;
+    strings += '\0';
+    return offset;
+}
+
+bool SceneBaker::write(const std::string& path) const {
+    // Nodes keep their indices, so the whole hierarchy is stored as soon as one shape uses it
+    std::vector<SceneNodeRecord> nodes;
+    if (usesTransforms) {
+        nodes.resize(Application::transforms.size());
+        for (size_t i = 0; i < nodes.size(); i++) {
+            TransformNode node = static_cast<TransformNode>(i);
+            nodes[i].parent = Application::transforms.getParent(node);
+            std::memcpy(nodes[i].local, glm::value_ptr(Application::transforms.getLocal(node)),
+                        sizeof(nodes[i].local));
+        }
+    }
+
+    SceneFileHeader header{};
+    std::memcpy(header.magic, ATLAS_SCENE_MAGIC, sizeof(header.magic));
+    header.version = ATLAS_SCENE_VERSION;
+    header.programCount = static_cast<uint32_t>(programs.size());
+    header.nodeCount = static_cast<uint32_t>(nodes.size());
+    header.shapeCount = static_cast<uint32_t>(shapes.size());
+    header.vertexCount = static_cast<uint32_t>(vertices.size());
+    header.indexCount = static_cast<uint32_t>(indices.size());
+    header.stringBytes = static_cast<uint32_t>(strings.size());
+
+    struct Section {
+        uint64_t* offset;
+        const void* bytes;
+        size_t size;
+    };
+    Section sections[] = {
+        {&header.programsOffset, programs.data(), programs.size() * sizeof(SceneProgramRecord)},
+        {&header.nodesOffset, nodes.data(), nodes.size() * sizeof(SceneNodeRecord)},
+        {&header.shapesOffset, shapes.data(), shapes.size() * sizeof(SceneShapeRecord)},
+        {&header.verticesOffset, vertices.data(), vertices.size() * sizeof(CoreVertex)},
+        {&header.indicesOffset, indices.data(), indices.size() * sizeof(GLuint)},
+        {&header.stringsOffset, strings.data(), strings.size()},
+    };
+
+    uint64_t end = sizeof(header);
+    for (Section& section : sections) {
+        *section.offset = (end + 15) & ~uint64_t(15);
+        end = *section.offset + section.size;
+    }
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        std::cerr << "Failed to open " << path << " for writing" << std::endl;
+        return false;
+    }
+
+    const char padding[16] = {};
+    uint64_t written = sizeof(header);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (const Section& section : sections) {
+        file.write(padding, static_cast<std::streamsize>(*section.offset - written));
+        file.write(static_cast<const char*>(section.bytes), static_cast<std::streamsize>(section.size));
+        written = *section.offset + section.size;
+    }
+    return static_cast<bool>(file);
+}
+
+BakedScene::BakedScene(const std::string& path) {
+#ifdef ATLAS_SCENE_MMAP
+    int descriptor = open(path.c_str(), O_RDONLY);
+    if (descriptor < 0) {
+        throw std::runtime_error("Failed to open " + path);
+    }
+
+    struct stat status;
+    if (fstat(descriptor, &status) != 0 || status.st_size == 0) {
+        close(descriptor);
+        throw std::runtime_error(path + " is not an Atlas scene");
+    }
+
+    byteSize = static_cast<size_t>(status.st_size);
+    void* mapping = mmap(nullptr, byteSize, PROT_READ, MAP_PRIVATE, descriptor, 0);
+    close(descriptor);
+    if (mapping == MAP_FAILED) {
+        throw std::runtime_error("Failed to map " + path);
+    }
+    data = static_cast<const unsigned char*>(mapping);
+#else
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Failed to open " + path);
+    }
+    buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    data = buffer.data();
+    byteSize = buffer.size();
+#endif
+
+    try {
+        validate(path);
+    }
+    catch (...) {
+        unmap();
+        throw;
+    }
+}
+
+BakedScene::~BakedScene() {
+    unmap();
+}
+
+void BakedScene::unmap() {
+#ifdef ATLAS_SCENE_MMAP
+    if (data != nullptr) {
+        munmap(const_cast<unsigned char*>(data), byteSize);
+    }
+#endif
+    buffer.clear();
+    data = nullptr;
+    byteSize = 0;
+}
+
+void BakedScene::validate(const std::string& path) {
+    if (byteSize < sizeof(SceneFileHeader)) {
+        throw std::runtime_error(path + " is not an Atlas scene");
+    }
+    header = reinterpret_cast<const SceneFileHeader*>(data);
+    if (std::memcmp(header->magic, ATLAS_SCENE_MAGIC, sizeof(header->magic)) != 0) {
+        throw std::runtime_error(path + " is not an Atlas scene");
+    }
+    if (header->version != ATLAS_SCENE_VERSION) {
+        throw std::runtime_error(path + " has unsupported scene version " + std::to_string(header->version));
+    }
+
+    // Only the section ranges and the records are checked, the vertex and index data is used as is
+    auto section = [this, &path](uint64_t offset, uint64_t count, uint64_t recordSize) {
+        if (offset % 16 != 0 || offset > byteSize || count * recordSize > byteSize - offset) {
+            throw std::runtime_error(path + " is truncated");
+        }
+        return data + offset;
+    };
+    programRecords = reinterpret_cast<const SceneProgramRecord*>(
+        section(header->programsOffset, header->programCount, sizeof(SceneProgramRecord)));
+    nodeRecords = reinterpret_cast<const SceneNodeRecord*>(
+        section(header->nodesOffset, header->nodeCount, sizeof(SceneNodeRecord)));
+    shapeRecords = reinterpret_cast<const SceneShapeRecord*>(
+        section(header->shapesOffset, header->shapeCount, sizeof(SceneShapeRecord)));
+    vertices = reinterpret_cast<const CoreVertex*>(
+        section(header->verticesOffset, header->vertexCount, sizeof(CoreVertex)));
+    indices = reinterpret_cast<const GLuint*>(section(header->indicesOffset, header->indexCount, sizeof(GLuint)));
+    strings = reinterpret_cast<const char*>(section(header->stringsOffset, header->stringBytes, 1));
+
+    if (header->stringBytes > 0 && strings[header->stringBytes - 1] != '\0') {
+        throw std::runtime_error(path + " has an unterminated string section");
+    }
+
+    for (uint32_t i = 0; i < header->programCount; i++) {
+        const SceneProgramRecord& program = programRecords[i];
+        bool valid = program.local
+                         ? program.vertexPath < header->stringBytes && program.fragmentPath < header->stringBytes
+                         : program.shader <= static_cast<uint32_t>(AtlasShader::Sprite);
+        if (!valid) {
+            throw std::runtime_error(path + " has an invalid program " + std::to_string(i));
+        }
+    }
+
+    for (uint32_t i = 0; i < header->nodeCount; i++) {
+        int32_t parent = nodeRecords[i].parent;
+        if (parent < -1 || parent >= static_cast<int32_t>(i)) {
+            throw std::runtime_error(path + " has an invalid transform node " + std::to_string(i));
+        }
+    }
+
+    for (uint32_t i = 0; i < header->shapeCount; i++) {
+        const SceneShapeRecord& shape = shapeRecords[i];
+        bool valid = shape.name < header->stringBytes && shape.program < header->programCount &&
+                     shape.mode == GL_TRIANGLES &&
+                     uint64_t(shape.firstIndex) + shape.indexCount <= header->indexCount &&
+                     shape.baseVertex >= 0 &&
+                     uint64_t(shape.baseVertex) + shape.vertexCount <= header->vertexCount &&
+                     shape.node >= -1 && shape.node < static_cast<int32_t>(header->nodeCount);
+        if (!valid) {
+            throw std::runtime_error(path + " has an invalid shape " + std::to_string(i));
+        }
+    }
+}
+
+CoreGeometry BakedScene::getGeometry() const {
+    std::vector<glm::mat4> worlds(header->nodeCount);
+    for (uint32_t i = 0; i < header->nodeCount; i++) {
+        const SceneNodeRecord& record = nodeRecords[i];
+        std::memcpy(&worlds[i], record.local, sizeof(record.local));
+        if (record.parent >= 0) {
+            worlds[i] = worlds[record.parent] * worlds[i];
+        }
+    }
+
+    CoreGeometry geometry;
+    geometry.vertices.reserve(header->vertexCount);
+    geometry.indices.reserve(header->indexCount);
+    for (uint32_t i = 0; i < header->shapeCount; i++) {
+        const SceneShapeRecord& record = shapeRecords[i];
+        glm::vec3 offset(record.offset[0], record.offset[1], record.offset[2]);
+        glm::mat4 world = record.node < 0 ? glm::mat4(1.0f) : worlds[record.node];
+
+        // Indices were not checked when the file was opened, they are before being read here
+        GLuint base = static_cast<GLuint>(geometry.vertices.size());
+        for (uint32_t j = 0; j < record.indexCount; j++) {
+            GLuint index = indices[record.firstIndex + j];
+            if (index >= record.vertexCount) {
+                throw std::runtime_error("Shape " + getShapeName(i) + " has an index out of its vertex range");
+            }
+            geometry.indices.push_back(base + index);
+        }
+
+        for (uint32_t j = 0; j < record.vertexCount; j++) {
+            CoreVertex vertex = vertices[record.baseVertex + j];
+            vertex.position = glm::vec3(world * glm::vec4(vertex.position + offset, 1.0f));
+            geometry.vertices.push_back(vertex);
+        }
+    }
+    return geometry;
+}
+
+std::string BakedScene::getShapeName(size_t shape) const {
+    return strings + shapeRecords[shape].name;
+}
+
+void BakedScene::render() {
+    if (header->shapeCount == 0) {
+        return;
+    }
+
+    // Every shape is a range of one upload made straight from the file
+    CoreMesh block = Application::instance.uploadMesh(vertices, header->vertexCount, indices, header->indexCount,
+                                                      GL_TRIANGLES);
+
+    std::vector<TransformNode> nodes(header->nodeCount);
+    for (uint32_t i = 0; i < header->nodeCount; i++) {
+        const SceneNodeRecord& record = nodeRecords[i];
+        glm::mat4 local;
+        std::memcpy(&local, record.local, sizeof(record.local));
+        nodes[i] = Application::transforms.create(record.parent < 0 ? ATLAS_NO_TRANSFORM : nodes[record.parent], local);
+    }
+
+    std::vector<GLuint> programs(header->programCount);
+    for (uint32_t i = 0; i < header->programCount; i++) {
+        const SceneProgramRecord& record = programRecords[i];
+        if (record.local) {
+            programs[i] = Application::instance.getProgram(Shader(strings + record.vertexPath,
+                                                                  strings + record.fragmentPath));
+            continue;
+        }
+
+        Shader shader(static_cast<AtlasShader>(record.shader));
+        if (!Application::instance.usesIndirectBatch(shader)) {
+            programs[i] = Application::instance.getProgram(shader);
+        }
+    }
+
+    for (uint32_t i = 0; i < header->shapeCount; i++) {
+        const SceneShapeRecord& record = shapeRecords[i];
+        CoreMesh mesh = block;
+        mesh.firstIndex = block.firstIndex + record.firstIndex;
+        mesh.baseVertex = block.baseVertex + record.baseVertex;
+        mesh.indexCount = static_cast<GLsizei>(record.indexCount);
+        mesh.mode = record.mode;
+        mesh.pooled = true;
+        mesh.boundsMin = glm::vec3(record.boundsMin[0], record.boundsMin[1], record.boundsMin[2]);
+        mesh.boundsMax = glm::vec3(record.boundsMax[0], record.boundsMax[1], record.boundsMax[2]);
+
+        glm::vec3 offset(record.offset[0], record.offset[1], record.offset[2]);
+        TransformNode node = record.node < 0 ? ATLAS_NO_TRANSFORM : nodes[record.node];
+        Application::instance.submitMesh(mesh, programs[record.program], offset, node);
+    }
+}
@@ -5,7 +5,17 @@ out vec4 vertexColor;
 uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
+uniform vec3 offset;
+uniform bool useTransforms;
+uniform int transformIndex;
+uniform samplerBuffer transforms;
 void main() {
-    gl_Position = projection * view * model * vec4(aPosition, 1.0);
+    mat4 world = model;
+    if (useTransforms) {
+        int base = transformIndex * 4;
+        world = model * mat4(texelFetch(transforms, base), texelFetch(transforms, base + 1),
+                             texelFetch(transforms, base + 2), texelFetch(transforms, base + 3));
+    }
+    gl_Position = projection * view * world * vec4(aPosition + offset, 1.0);
     vertexColor = aColor;
 }
\ No newline at end of file
@@ -0,0 +1,20 @@
+#version 450 core
+layout(location = 0) in vec3 aPosition;
+layout(location = 1) in vec4 aColor;
+layout(location = 2) in vec4 aDraw;
+out vec4 vertexColor;
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+uniform samplerBuffer transforms;
+void main() {
+    mat4 world = model;
+    int transformIndex = int(aDraw.w);
+    if (transformIndex >= 0) {
+        int base = transformIndex * 4;
+        world = model * mat4(texelFetch(transforms, base), texelFetch(transforms, base + 1),
+                             texelFetch(transforms, base + 2), texelFetch(transforms, base + 3));
+    }
+    gl_Position = projection * view * world * vec4(aPosition + aDraw.xyz, 1.0);
+    vertexColor = aColor;
+}
\ No newline at end of file
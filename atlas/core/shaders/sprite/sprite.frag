@@ -0,0 +1,8 @@
+#version 330 core
+in vec2 TexCoords;
+in vec4 vertexColor;
+out vec4 FragColor;
+uniform sampler2D atlasTexture;
+void main() {
+    FragColor = texture(atlasTexture, TexCoords) * vertexColor;
+}
\ No newline at end of file
@@ -0,0 +1,14 @@
+#version 330 core
+layout(location = 0) in vec3 aPosition;
+layout(location = 1) in vec2 aTexCoords;
+layout(location = 2) in vec4 aColor;
+out vec2 TexCoords;
+out vec4 vertexColor;
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+void main() {
+    gl_Position = projection * view * model * vec4(aPosition, 1.0);
+    TexCoords = aTexCoords;
+    vertexColor = aColor;
+}
\ No newline at end of file
@@ -0,0 +1,308 @@
+/*
+* tessellation.cpp
+* As part of the Atlas project
+* Created by Maxims Enterprise in 2024
+* --------------------------------------
+* Description: Tessellation of primitives into indexed meshes
+* Copyright (c) 2024 Maxims Enterprise
+*/
+
+#include <atlas/core/tessellation.h>
+#include "atlas/application.h"
+#include <cmath>
+#include <algorithm>
+#include <iostream>
+#include <glm/gtc/matrix_transform.hpp>
+
+// Maximum distance, in pixels, between a curve and its tessellated chord
+constexpr float ATLAS_TESSELLATION_TOLERANCE = 0.25f;
+
+size_t TessellationKeyHash::operator()(const TessellationKey& key) const {
+    size_t hash = std::hash<int>()(static_cast<int>(key.kind));
+    hash ^= std::hash<int>()(key.lod) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+    for (float parameter : key.parameters) {
+        hash ^= std::hash<float>()(parameter) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+    }
+    return hash;
+}
+
+int segmentsForLOD(int lod) {
+    return 8 << std::clamp(lod, 0, ATLAS_MAX_LOD);
+}
+
+int lodForScreenRadius(float pixels) {
+    if (pixels <= ATLAS_TESSELLATION_TOLERANCE) {
+        return 0;
+    }
+
+    // Number of chords needed so that no chord strays from the curve by more than the tolerance
+    float needed = static_cast<float>(M_PI) / std::acos(1.0f - ATLAS_TESSELLATION_TOLERANCE / pixels);
+    for (int lod = 0; lod < ATLAS_MAX_LOD; lod++) {
+        if (static_cast<float>(segmentsForLOD(lod)) >= needed) {
+            return lod;
+        }
+    }
+    return ATLAS_MAX_LOD;
+}
+
+float screenSpaceRadius(const glm::mat4& transform, glm::vec2 halfExtent) {
+    glm::mat4 full = RenderInstance::projection * RenderInstance::view * RenderInstance::model * transform;
+
+    glm::vec4 center = full * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    glm::vec4 xEdge = full * glm::vec4(halfExtent.x, 0.0f, 0.0f, 1.0f);
+    glm::vec4 yEdge = full * glm::vec4(0.0f, halfExtent.y, 0.0f, 1.0f);
+    if (center.w <= 0.0f || xEdge.w <= 0.0f || yEdge.w <= 0.0f) {
+        return 0.0f;
+    }
+
+    glm::vec2 viewport(Application::width * 0.5f, Application::height * 0.5f);
+    glm::vec2 centerNDC(center.x / center.w, center.y / center.w);
+    glm::vec2 xDelta = glm::vec2(xEdge.x / xEdge.w, xEdge.y / xEdge.w) - centerNDC;
+    glm::vec2 yDelta = glm::vec2(yEdge.x / yEdge.w, yEdge.y / yEdge.w) - centerNDC;
+
+    float xPixels = glm::length(glm::vec2(xDelta.x * viewport.x, xDelta.y * viewport.y));
+    float yPixels = glm::length(glm::vec2(yDelta.x * viewport.x, yDelta.y * viewport.y));
+    return std::max(xPixels, yPixels);
+}
+
+int lodForPlacement(glm::vec3 position, TransformNode node, glm::vec2 halfExtent) {
+    glm::mat4 transform = glm::translate(glm::mat4(1.0f), position);
+    if (node != ATLAS_NO_TRANSFORM) {
+        transform = Application::transforms.getWorld(node) * transform;
+    }
+    return lodForScreenRadius(screenSpaceRadius(transform, halfExtent));
+}
+
+CoreGeometry tessellateRectangle(glm::vec2 size, glm::vec4 color) {
+    CoreGeometry geometry;
+    geometry.vertices = {
+        {glm::vec3(0.0f, 0.0f, 0.0f), color},
+        {glm::vec3(size.x, 0.0f, 0.0f), color},
+        {glm::vec3(size.x, size.y, 0.0f), color},
+        {glm::vec3(0.0f, size.y, 0.0f), color},
+    };
+    geometry.indices = {0, 1, 2, 0, 2, 3};
+    return geometry;
+}
+
+CoreGeometry tessellateEllipse(glm::vec2 radii, glm::vec4 color, int segments) {
+    CoreGeometry geometry;
+    geometry.vertices.reserve(segments + 1);
+    geometry.indices.reserve(segments * 3);
+
+    geometry.vertices.push_back({glm::vec3(0.0f), color});
+    for (int i = 0; i < segments; i++) {
+        float angle = 2.0f * static_cast<float>(M_PI) * static_cast<float>(i) / static_cast<float>(segments);
+        geometry.vertices.push_back({glm::vec3(radii.x * std::cos(angle), radii.y * std::sin(angle), 0.0f), color});
+    }
+
+    for (int i = 0; i < segments; i++) {
+        geometry.indices.push_back(0);
+        geometry.indices.push_back(i + 1);
+        geometry.indices.push_back((i + 1) % segments + 1);
+    }
+    return geometry;
+}
+
+static float cross(glm::vec2 a, glm::vec2 b) {
+    return a.x * b.y - a.y * b.x;
+}
+
+static bool pointInTriangle(glm::vec2 p, glm::vec2 a, glm::vec2 b, glm::vec2 c) {
+    return cross(b - a, p - a) >= 0.0f && cross(c - b, p - b) >= 0.0f && cross(a - c, p - c) >= 0.0f;
+}
+
+CoreGeometry tessellatePolygon(const std::vector<glm::vec2>& points, glm::vec4 color) {
+    CoreGeometry geometry;
+    if (points.size() < 3) {
+        return geometry;
+    }
+
+    geometry.vertices.reserve(points.size());
+    for (const glm::vec2& point : points) {
+        geometry.vertices.push_back({glm::vec3(point, 0.0f), color});
+    }
+
+    // Ear clipping works on a counter-clockwise outline
+    float area = 0.0f;
+    for (size_t i = 0; i < points.size(); i++) {
+        area += cross(points[i], points[(i + 1) % points.size()]);
+    }
+
+    std::vector<GLuint> remaining(points.size());
+    for (size_t i = 0; i < points.size(); i++) {
+        remaining[i] = static_cast<GLuint>(area >= 0.0f ? i : points.size() - 1 - i);
+    }
+
+    geometry.indices.reserve((points.size() - 2) * 3);
+    size_t current = 0;
+    size_t attempts = 0;
+    while (remaining.size() > 3 && attempts < remaining.size()) {
+        size_t count = remaining.size();
+        GLuint previous = remaining[(current + count - 1) % count];
+        GLuint ear = remaining[current % count];
+        GLuint next = remaining[(current + 1) % count];
+        glm::vec2 a = points[previous], b = points[ear], c = points[next];
+
+        bool isEar = cross(b - a, c - b) > 0.0f;
+        for (size_t i = 0; isEar && i < count; i++) {
+            GLuint other = remaining[i];
+            if (other != previous && other != ear && other != next && pointInTriangle(points[other], a, b, c)) {
+                isEar = false;
+            }
+        }
+
+        if (isEar) {
+            geometry.indices.insert(geometry.indices.end(), {previous, ear, next});
+            remaining.erase(remaining.begin() + static_cast<long>(current % count));
+            attempts = 0;
+        }
+        else {
+            current++;
+            attempts++;
+        }
+    }
+
+    // Self-intersecting outlines run out of ears, and what remains cannot be filled
+    if (remaining.size() == 3) {
+        geometry.indices.insert(geometry.indices.end(), {remaining[0], remaining[1], remaining[2]});
+    }
+    else {
+        std::cerr << "Failed to tessellate polygon: " << remaining.size() << " of " << points.size()
+                  << " points left without triangles, the outline may intersect itself" << std::endl;
+    }
+    return geometry;
+}
+
+CoreGeometry tessellateStroke(const std::vector<glm::vec2>& points, float thickness, bool closed, glm::vec4 color) {
+    CoreGeometry geometry;
+
+    std::vector<glm::vec2> path;
+    path.reserve(points.size());
+    for (const glm::vec2& point : points) {
+        if (path.empty() || glm::length(point - path.back()) > 0.0f) {
+            path.push_back(point);
+        }
+    }
+    if (closed && path.size() > 1 && glm::length(path.front() - path.back()) == 0.0f) {
+        path.pop_back();
+    }
+    if (path.size() < 2) {
+        return geometry;
+    }
+
+    float half = thickness * 0.5f;
+    size_t count = path.size();
+    auto normalOf = [&path, count](size_t from) {
+        glm::vec2 direction = glm::normalize(path[(from + 1) % count] - path[from]);
+        return glm::vec2(-direction.y, direction.x);
+    };
+
+    geometry.vertices.reserve(count * 2);
+    for (size_t i = 0; i < count; i++) {
+        bool hasPrevious = closed || i > 0;
+        bool hasNext = closed || i + 1 < count;
+
+        glm::vec2 offset;
+        if (hasPrevious && hasNext) {
+            glm::vec2 before = normalOf((i + count - 1) % count);
+            glm::vec2 after = normalOf(i);
+            glm::vec2 miter = before + after;
+            float miterLength = glm::length(miter);
+            if (miterLength < 1e-6f) {
+                offset = after * half;
+            }
+            else {
+                miter = miter / miterLength;
+                float length = half / std::max(glm::dot(miter, after), 1.0f / ATLAS_MITER_LIMIT);
+                offset = miter * length;
+            }
+        }
+        else {
+            offset = normalOf(hasNext ? i : i - 1) * half;
+        }
+
+        geometry.vertices.push_back({glm::vec3(path[i] + offset, 0.0f), color});
+        geometry.vertices.push_back({glm::vec3(path[i] - offset, 0.0f), color});
+    }
+
+    size_t segments = closed ? count : count - 1;
+    geometry.indices.reserve(segments * 6);
+    for (size_t i = 0; i < segments; i++) {
+        GLuint a = static_cast<GLuint>(i * 2);
+        GLuint b = static_cast<GLuint>(((i + 1) % count) * 2);
+        geometry.indices.insert(geometry.indices.end(), {a, a + 1, b, a + 1, b + 1, b});
+    }
+    return geometry;
+}
+
+void computeBounds(const CoreGeometry& geometry, CoreMesh& mesh) {
+    for (size_t i = 0; i < geometry.vertices.size(); i++) {
+        const glm::vec3& position = geometry.vertices[i].position;
+        mesh.boundsMin = i == 0 ? position : glm::min(mesh.boundsMin, position);
+        mesh.boundsMax = i == 0 ? position : glm::max(mesh.boundsMax, position);
+    }
+}
+
+const CoreMesh& TessellationCache::get(const TessellationKey& key, const std::function<CoreGeometry()>& tessellate) {
+    auto found = meshes.find(key);
+    if (found != meshes.end()) {
+        hits++;
+        return found->second;
+    }
+
+    misses++;
+    CoreGeometry geometry = tessellate();
+    CoreMesh mesh = Application::instance.uploadMesh(geometry.vertices, geometry.indices, GL_TRIANGLES);
+    computeBounds(geometry, mesh);
+    return meshes.emplace(key, mesh).first->second;
+}
+
+void TessellationCache::clear() {
+    for (auto& [key, mesh] : meshes) {
+        Application::instance.destroyMesh(mesh);
+    }
+    meshes.clear();
+    adaptive.clear();
+    adaptiveByNode.clear();
+}
+
+void TessellationCache::track(AdaptiveDraw draw) {
+    if (draw.node != ATLAS_NO_TRANSFORM) {
+        if (adaptiveByNode.size() <= static_cast<size_t>(draw.node)) {
+            adaptiveByNode.resize(draw.node + 1);
+        }
+        adaptiveByNode[draw.node].push_back(adaptive.size());
+    }
+    adaptive.push_back(std::move(draw));
+}
+
+void TessellationCache::updateLevels(const std::vector<TransformNode>& movedNodes, bool viewChanged) {
+    if (viewChanged) {
+        for (AdaptiveDraw& draw : adaptive) {
+            updateLevel(draw);
+        }
+        return;
+    }
+
+    for (TransformNode node : movedNodes) {
+        if (static_cast<size_t>(node) >= adaptiveByNode.size()) {
+            continue;
+        }
+        for (size_t index : adaptiveByNode[node]) {
+            updateLevel(adaptive[index]);
+        }
+    }
+}
+
+void TessellationCache::updateLevel(AdaptiveDraw& draw) {
+    int lod = lodForPlacement(draw.position, draw.node, draw.halfExtent);
+    if (lod == draw.key.lod) {
+        return;
+    }
+
+    // Meshes of earlier levels stay cached, shapes going back and forth reuse them
+    draw.key.lod = lod;
+    const CoreMesh& mesh = get(draw.key, [&draw, lod]() { return draw.tessellate(lod); });
+    Application::instance.replaceMesh(draw.draw, mesh);
+}
@@ -0,0 +1,439 @@
+/*
+* texture_atlas.cpp
+* As part of the Atlas project
+* Created by Maxims Enterprise in 2024
+* --------------------------------------
+* Description: Runtime texture atlas packing and sprite batching
+* Copyright (c) 2024 Maxims Enterprise
+*/
+
+#include <atlas/core/texture_atlas.h>
+#include "atlas/application.h"
+#include <iostream>
+#include <algorithm>
+#include <climits>
+#include <glm/gtc/type_ptr.hpp>
+
+SkylinePacker::SkylinePacker(int width, int height) : width(width), height(height) {
+    reset();
+}
+
+void SkylinePacker::reset() {
+    skyline.clear();
+    skyline.push_back({0, 0, width});
+    usedArea = 0;
+}
+
+float SkylinePacker::occupancy() const {
+    return static_cast<float>(usedArea) / static_cast<float>(width * height);
+}
+
+int SkylinePacker::fit(size_t index, int width, int height) const {
+    int x = skyline[index].x;
+    if (x + width > this->width) {
+        return -1;
+    }
+
+    int y = skyline[index].y;
+    int remaining = width;
+    for (size_t i = index; remaining > 0; i++) {
+        if (i == skyline.size()) {
+            return -1;
+        }
+        y = std::max(y, skyline[i].y);
+        if (y + height > this->height) {
+            return -1;
+        }
+        remaining -= skyline[i].width;
+    }
+    return y;
+}
+
+bool SkylinePacker::insert(int width, int height, AtlasRect& result) {
+    int bestTop = INT_MAX;
+    int bestWidth = INT_MAX;
+    size_t bestIndex = skyline.size();
+
+    for (size_t i = 0; i < skyline.size(); i++) {
+        int y = fit(i, width, height);
+        if (y < 0) {
+            continue;
+        }
+        if (y + height < bestTop || (y + height == bestTop && skyline[i].width < bestWidth)) {
+            bestTop = y + height;
+            bestWidth = skyline[i].width;
+            bestIndex = i;
+            result = {skyline[i].x, y, width, height};
+        }
+    }
+
+    if (bestIndex == skyline.size()) {
+        return false;
+    }
+
+    skyline.insert(skyline.begin() + static_cast<long>(bestIndex), {result.x, result.y + height, width});
+
+    // Cut back the segments now covered by the new one
+    for (size_t i = bestIndex + 1; i < skyline.size();) {
+        const SkylineNode& previous = skyline[i - 1];
+        int overlap = previous.x + previous.width - skyline[i].x;
+        if (overlap <= 0) {
+            break;
+        }
+        skyline[i].x += overlap;
+        skyline[i].width -= overlap;
+        if (skyline[i].width <= 0) {
+            skyline.erase(skyline.begin() + static_cast<long>(i));
+        }
+        else {
+            break;
+        }
+    }
+
+    for (size_t i = 0; i + 1 < skyline.size();) {
+        if (skyline[i].y == skyline[i + 1].y) {
+            skyline[i].width += skyline[i + 1].width;
+            skyline.erase(skyline.begin() + static_cast<long>(i) + 1);
+        }
+        else {
+            i++;
+        }
+    }
+
+    usedArea += static_cast<long>(width) * height;
+    return true;
+}
+
+AtlasLayout::AtlasLayout(int pageSize, int padding, int maxPages) : pageSize(pageSize), padding(padding),
+                                                                     maxPages(maxPages) {
+}
+
+const AtlasRegion* AtlasLayout::find(const std::string& key) {
+    auto found = regions.find(key);
+    if (found == regions.end()) {
+        return nullptr;
+    }
+    pages[found->second.page].lastUsed = frame;
+    return &found->second;
+}
+
+const AtlasRegion* AtlasLayout::place(const std::string& key, int width, int height, AtlasRect& rect) {
+    int paddedWidth = width + padding * 2;
+    int paddedHeight = height + padding * 2;
+    if (paddedWidth > pageSize || paddedHeight > pageSize) {
+        std::cerr << "Image " << key << " does not fit in a " << pageSize << "x" << pageSize << " atlas page" <<
+            std::endl;
+        return nullptr;
+    }
+
+    int page = -1;
+    for (size_t i = 0; i < pages.size(); i++) {
+        if (pages[i].packer.insert(paddedWidth, paddedHeight, rect)) {
+            page = static_cast<int>(i);
+            break;
+        }
+    }
+
+    if (page < 0) {
+        if (static_cast<int>(pages.size()) < maxPages) {
+            pages.push_back({SkylinePacker(pageSize, pageSize), frame, {}});
+            page = static_cast<int>(pages.size()) - 1;
+        }
+        else {
+            page = chooseEvictedPage();
+            if (page < 0) {
+                std::cerr << "Texture atlas is full, cannot add " << key << std::endl;
+                return nullptr;
+            }
+            evictPage(page);
+        }
+        pages[page].packer.insert(paddedWidth, paddedHeight, rect);
+    }
+
+    pages[page].keys.push_back(key);
+    pages[page].lastUsed = frame;
+
+    float size = static_cast<float>(pageSize);
+    AtlasRegion region = {
+        page,
+        glm::vec2(static_cast<float>(rect.x + padding) / size, static_cast<float>(rect.y + padding) / size),
+        glm::vec2(static_cast<float>(rect.x + padding + width) / size,
+                  static_cast<float>(rect.y + padding + height) / size),
+    };
+    return &regions.emplace(key, region).first->second;
+}
+
+int AtlasLayout::chooseEvictedPage() const {
+    // Pages used during this frame cannot be evicted, their regions are already in flight. Among
+    // pages last used equally long ago, the emptiest one loses the fewest images
+    int page = -1;
+    for (size_t i = 0; i < pages.size(); i++) {
+        const LayoutPage& candidate = pages[i];
+        if (candidate.lastUsed == frame) {
+            continue;
+        }
+        if (page < 0 || candidate.lastUsed < pages[page].lastUsed ||
+            (candidate.lastUsed == pages[page].lastUsed &&
+             candidate.packer.occupancy() < pages[page].packer.occupancy())) {
+            page = static_cast<int>(i);
+        }
+    }
+    return page;
+}
+
+void AtlasLayout::evictPage(int page) {
+    for (const std::string& key : pages[page].keys) {
+        regions.erase(key);
+    }
+    pages[page].keys.clear();
+    pages[page].packer.reset();
+    evictions++;
+}
+
+void AtlasLayout::nextFrame() {
+    frame++;
+}
+
+void AtlasLayout::clear() {
+    pages.clear();
+    regions.clear();
+}
+
+TextureAtlas::TextureAtlas(int pageSize, int padding, int maxPages) : layout(pageSize, padding, maxPages) {
+}
+
+const AtlasRegion* TextureAtlas::find(const std::string& key) {
+    return layout.find(key);
+}
+
+const AtlasRegion* TextureAtlas::add(const std::string& key, const Image& image) {
+    if (const AtlasRegion* existing = layout.find(key)) {
+        return existing;
+    }
+
+    AtlasRect rect{};
+    const AtlasRegion* region = layout.place(key, image.width, image.height, rect);
+    if (!region) {
+        return nullptr;
+    }
+
+    while (textures.size() < layout.pageCount()) {
+        createPage();
+    }
+    upload(textures[region->page], rect, image);
+    return region;
+}
+
+void TextureAtlas::nextFrame() {
+    layout.nextFrame();
+}
+
+void TextureAtlas::clear() {
+    glDeleteTextures(static_cast<GLsizei>(textures.size()), textures.data());
+    textures.clear();
+    layout.clear();
+}
+
+GLuint TextureAtlas::getPageTexture(int page) const {
+    return textures[page];
+}
+
+void TextureAtlas::createPage() {
+    int pageSize = layout.getPageSize();
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, pageSize, pageSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    textures.push_back(texture);
+}
+
+void TextureAtlas::upload(GLuint texture, const AtlasRect& rect, const Image& image) const {
+    // The padding repeats the edge pixels so linear filtering never picks up a neighbour
+    int padding = layout.getPadding();
+    std::vector<unsigned char> padded(static_cast<size_t>(rect.width) * rect.height * 4);
+    for (int y = 0; y < rect.height; y++) {
+        int sourceY = std::clamp(y - padding, 0, image.height - 1);
+        for (int x = 0; x < rect.width; x++) {
+            int sourceX = std::clamp(x - padding, 0, image.width - 1);
+            const unsigned char* source = &image.pixels[(static_cast<size_t>(sourceY) * image.width + sourceX) * 4];
+            std::copy(source, source + 4, &padded[(static_cast<size_t>(y) * rect.width + x) * 4]);
+        }
+    }
+
+    // Rows of the padded copy are tightly packed; the default alignment is restored for other uploads
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, rect.x, rect.y, rect.width, rect.height, GL_RGBA, GL_UNSIGNED_BYTE,
+                    padded.data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void SpriteBatch::add(SpriteInstance sprite) {
+    Application::damage.addBounds(RenderInstance::model, sprite.position,
+                                  sprite.position + glm::vec3(sprite.size, 0.0f));
+    sprites.push_back(std::move(sprite));
+    dirty = true;
+
+    if (!registered) {
+        Application::renderFunctions.add_function([this]() { draw(); });
+        registered = true;
+    }
+}
+
+void SpriteBatch::reserveQuadIndices(size_t quads) {
+    if (quads <= quadCapacity) {
+        return;
+    }
+
+    quadCapacity = std::max(quads, quadCapacity * 2);
+    std::vector<GLuint> indices;
+    indices.reserve(quadCapacity * 6);
+    for (size_t i = 0; i < quadCapacity; i++) {
+        GLuint base = static_cast<GLuint>(i * 4);
+        indices.insert(indices.end(), {base, base + 1, base + 2, base, base + 2, base + 3});
+    }
+
+    // Every page stream shares this buffer, it keeps its name when it grows
+    glBindVertexArray(0);
+    if (quadIndices == 0) {
+        glGenBuffers(1, &quadIndices);
+    }
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, quadIndices);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+void SpriteBatch::rebuild() {
+    FrameArena& arena = Application::frameArenas.current();
+
+    // Touch the regions that are already packed first, so adding new images never evicts them
+    FrameVector<const AtlasRegion*> placed(sprites.size(), nullptr, ArenaAllocator<const AtlasRegion*>(arena));
+    for (size_t i = 0; i < sprites.size(); i++) {
+        placed[i] = atlas.find(sprites[i].imageKey);
+    }
+    for (size_t i = 0; i < sprites.size(); i++) {
+        if (!placed[i]) {
+            placed[i] = atlas.add(sprites[i].imageKey, *sprites[i].image);
+        }
+    }
+
+    // Quads are staged in one arena array, grouped by page
+    size_t pageCount = atlas.pageCount();
+    FrameVector<size_t> pageOffsets(pageCount + 1, 0, ArenaAllocator<size_t>(arena));
+    for (const AtlasRegion* region : placed) {
+        if (region) {
+            pageOffsets[region->page + 1] += 4;
+        }
+    }
+    size_t largestPage = 0;
+    for (size_t page = 0; page < pageCount; page++) {
+        largestPage = std::max(largestPage, pageOffsets[page + 1] / 4);
+        pageOffsets[page + 1] += pageOffsets[page];
+    }
+
+    FrameVector<SpriteVertex> vertices(pageOffsets[pageCount], ArenaAllocator<SpriteVertex>(arena));
+    FrameVector<size_t> cursors(pageOffsets.begin(), pageOffsets.end() - 1, ArenaAllocator<size_t>(arena));
+    for (size_t i = 0; i < sprites.size(); i++) {
+        const AtlasRegion* region = placed[i];
+        if (!region) {
+            continue;
+        }
+
+        const SpriteInstance& sprite = sprites[i];
+        glm::vec3 p = sprite.position;
+        SpriteVertex* quad = &vertices[cursors[region->page]];
+        cursors[region->page] += 4;
+        // The first image row sits at uvMin.y, which is the top of the quad
+        quad[0] = {p, glm::vec2(region->uvMin.x, region->uvMax.y), sprite.tint};
+        quad[1] = {glm::vec3(p.x + sprite.size.x, p.y, p.z), region->uvMax, sprite.tint};
+        quad[2] = {glm::vec3(p.x + sprite.size.x, p.y + sprite.size.y, p.z),
+                   glm::vec2(region->uvMax.x, region->uvMin.y), sprite.tint};
+        quad[3] = {glm::vec3(p.x, p.y + sprite.size.y, p.z), region->uvMin, sprite.tint};
+    }
+
+    reserveQuadIndices(largestPage);
+    streams.resize(pageCount);
+
+    for (size_t page = 0; page < pageCount; page++) {
+        PageStream& stream = streams[page];
+        if (stream.vao == 0) {
+            glGenVertexArrays(1, &stream.vao);
+            glGenBuffers(1, &stream.vbo);
+
+            glBindVertexArray(stream.vao);
+            glBindBuffer(GL_ARRAY_BUFFER, stream.vbo);
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(SpriteVertex), (void*)0); // Position
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(SpriteVertex),
+                                  (void*)offsetof(SpriteVertex, uv)); // Texture coordinates
+            glEnableVertexAttribArray(1);
+            glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(SpriteVertex),
+                                  (void*)offsetof(SpriteVertex, color)); // Color
+            glEnableVertexAttribArray(2);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, quadIndices);
+            glBindVertexArray(0);
+        }
+
+        size_t first = pageOffsets[page];
+        size_t count = pageOffsets[page + 1] - first;
+        glBindBuffer(GL_ARRAY_BUFFER, stream.vbo);
+        glBufferData(GL_ARRAY_BUFFER, count * sizeof(SpriteVertex), vertices.data() + first, GL_DYNAMIC_DRAW);
+        stream.indexCount = static_cast<GLsizei>(count / 4 * 6);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    dirty = false;
+    seenEvictions = atlas.evictions();
+}
+
+void SpriteBatch::draw() {
+    if (dirty || seenEvictions != atlas.evictions()) {
+        rebuild();
+    }
+
+    if (program == 0) {
+        program = Application::instance.getProgramFromShader(AtlasShader::Sprite);
+    }
+
+    glUseProgram(program);
+    glUniformMatrix4fv(glGetUniformLocation(program, "model"), 1, GL_FALSE, glm::value_ptr(RenderInstance::model));
+    glUniformMatrix4fv(glGetUniformLocation(program, "view"), 1, GL_FALSE, glm::value_ptr(RenderInstance::view));
+    glUniformMatrix4fv(glGetUniformLocation(program, "projection"), 1, GL_FALSE,
+                       glm::value_ptr(RenderInstance::projection));
+    glUniform1i(glGetUniformLocation(program, "atlasTexture"), 0);
+
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glActiveTexture(GL_TEXTURE0);
+
+    for (size_t page = 0; page < streams.size(); page++) {
+        if (streams[page].indexCount == 0) {
+            continue;
+        }
+        glBindTexture(GL_TEXTURE_2D, atlas.getPageTexture(static_cast<int>(page)));
+        glBindVertexArray(streams[page].vao);
+        glDrawElements(GL_TRIANGLES, streams[page].indexCount, GL_UNSIGNED_INT, nullptr);
+    }
+
+    glBindVertexArray(0);
+    glDisable(GL_BLEND);
+}
+
+void SpriteBatch::clear() {
+    for (PageStream& stream : streams) {
+        glDeleteBuffers(1, &stream.vbo);
+        glDeleteVertexArrays(1, &stream.vao);
+    }
+    glDeleteBuffers(1, &quadIndices);
+    streams.clear();
+    sprites.clear();
+    quadIndices = 0;
+    quadCapacity = 0;
+}
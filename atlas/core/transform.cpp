@@ -0,0 +1,191 @@
+/*
+* transform.cpp
+* As part of the Atlas project
+* Created by Maxims Enterprise in 2024
+* --------------------------------------
+* Description: Per-object transform hierarchy
+* Copyright (c) 2024 Maxims Enterprise
+*/
+
+#include <atlas/core/transform.h>
+#include "atlas/application.h"
+#include <algorithm>
+
+TransformNode TransformHierarchy::create(TransformNode parent, const glm::mat4& local) {
+    TransformNode node = static_cast<TransformNode>(parents.size());
+    int depth = parent == ATLAS_NO_TRANSFORM ? 0 : depths[parent] + 1;
+
+    parents.push_back(parent);
+    depths.push_back(depth);
+    children.emplace_back();
+    locals.push_back(local);
+    worlds.push_back(local);
+    stamps.push_back(stamp);
+
+    if (parent != ATLAS_NO_TRANSFORM) {
+        children[parent].push_back(node);
+    }
+
+    setLocal(node, local);
+    return node;
+}
+
+void TransformHierarchy::setLocal(TransformNode node, const glm::mat4& local) {
+    locals[node] = local;
+    if (pending.size() <= static_cast<size_t>(depths[node])) {
+        pending.resize(depths[node] + 1);
+    }
+    pending[depths[node]].push_back(node);
+    dirty = true;
+}
+
+const glm::mat4& TransformHierarchy::getLocal(TransformNode node) const {
+    return locals[node];
+}
+
+const glm::mat4& TransformHierarchy::getWorld(TransformNode node) const {
+    return worlds[node];
+}
+
+void TransformHierarchy::update() {
+    updated.clear();
+    if (!dirty) {
+        return;
+    }
+
+    // A node is visited at most once per update, either because it changed or because its parent did
+    stamp++;
+    level.clear();
+    next.clear();
+
+    for (size_t depth = 0; depth < pending.size() || !next.empty(); depth++) {
+        level.swap(next);
+        next.clear();
+
+        if (depth < pending.size()) {
+            for (TransformNode node : pending[depth]) {
+                if (stamps[node] != stamp) {
+                    stamps[node] = stamp;
+                    level.push_back(node);
+                }
+            }
+            pending[depth].clear();
+        }
+
+        if (level.empty()) {
+            continue;
+        }
+
+        updateLevel(level);
+        updated.insert(updated.end(), level.begin(), level.end());
+
+        for (TransformNode node : level) {
+            size_t index = static_cast<size_t>(node);
+            if (uploadBegin == uploadEnd) {
+                uploadBegin = index;
+                uploadEnd = index + 1;
+            }
+            else {
+                uploadBegin = std::min(uploadBegin, index);
+                uploadEnd = std::max(uploadEnd, index + 1);
+            }
+
+            for (TransformNode child : children[node]) {
+                if (stamps[child] != stamp) {
+                    stamps[child] = stamp;
+                    next.push_back(child);
+                }
+            }
+        }
+    }
+
+    dirty = false;
+}
+
+void TransformHierarchy::updateLevel(const std::vector<TransformNode>& nodes) {
+    // Parents always live in an earlier level, so every node of a level can be computed independently
+    auto compute = [this, &nodes](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            TransformNode node = nodes[i];
+            TransformNode parent = parents[node];
+            worlds[node] = parent == ATLAS_NO_TRANSFORM ? locals[node] : worlds[parent] * locals[node];
+        }
+    };
+
+    if (nodes.size() < parallelThreshold) {
+        compute(0, nodes.size());
+        return;
+    }
+
+    Application::jobs.parallelFor(0, nodes.size(), 0, compute);
+}
+
+void TransformHierarchy::upload() {
+    if (uploadBegin == uploadEnd) {
+        return;
+    }
+
+    bool directStateAccess = Application::instance.directStateAccess;
+    if (bufferCapacity < worlds.size()) {
+        bufferCapacity = std::max(worlds.size(), bufferCapacity * 2);
+        GLsizeiptr bytes = static_cast<GLsizeiptr>(bufferCapacity * sizeof(glm::mat4));
+        if (directStateAccess) {
+            if (texture == 0) {
+                glCreateBuffers(1, &buffer);
+                glCreateTextures(GL_TEXTURE_BUFFER, 1, &texture);
+            }
+            glNamedBufferData(buffer, bytes, nullptr, GL_DYNAMIC_DRAW);
+            glTextureBuffer(texture, GL_RGBA32F, buffer);
+        }
+        else {
+            if (texture == 0) {
+                glGenBuffers(1, &buffer);
+                glGenTextures(1, &texture);
+            }
+            glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+            glBufferData(GL_TEXTURE_BUFFER, bytes, nullptr, GL_DYNAMIC_DRAW);
+            glBindTexture(GL_TEXTURE_BUFFER, texture);
+            glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, buffer);
+            glBindTexture(GL_TEXTURE_BUFFER, 0);
+            glBindBuffer(GL_TEXTURE_BUFFER, 0);
+        }
+
+        // The new storage is empty, every matrix has to be sent again
+        uploadBegin = 0;
+        uploadEnd = worlds.size();
+    }
+
+    GLintptr offset = static_cast<GLintptr>(uploadBegin * sizeof(glm::mat4));
+    GLsizeiptr size = static_cast<GLsizeiptr>((uploadEnd - uploadBegin) * sizeof(glm::mat4));
+    if (directStateAccess) {
+        glNamedBufferSubData(buffer, offset, size, &worlds[uploadBegin]);
+    }
+    else {
+        glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+        glBufferSubData(GL_TEXTURE_BUFFER, offset, size, &worlds[uploadBegin]);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    }
+
+    uploadBegin = 0;
+    uploadEnd = 0;
+}
+
+void TransformHierarchy::clear() {
+    glDeleteTextures(1, &texture);
+    glDeleteBuffers(1, &buffer);
+    texture = 0;
+    buffer = 0;
+    bufferCapacity = 0;
+
+    parents.clear();
+    depths.clear();
+    children.clear();
+    locals.clear();
+    worlds.clear();
+    pending.clear();
+    stamps.clear();
+    updated.clear();
+    uploadBegin = 0;
+    uploadEnd = 0;
+    dirty = false;
+}
@@ -10,6 +10,7 @@
 #include "atlas/shape.h"
 
 #include <iostream>
+#include <glm/gtc/matrix_transform.hpp>
 
 #include "atlas/application.h"
 
@@ -24,16 +25,18 @@ Triangle::Triangle(const std::string name, Color color, Size size, Position posi
 }
 
 void Triangle::render() {
-    GLuint program;
-    if (shader.isLocal) {
-        program = Application::instance.getProgramFromLocal(shader.vertexShader, shader.fragmentShader);
-    }
-    else {
-        program = Application::instance.getProgramFromShader(shader.type);
-    }
+    GLuint program = Application::instance.getProgram(shader);
 
     std::cout << "Rendering triangle" << std::endl;
 
+    glm::vec3 boundsMin = vertices[0].position;
+    glm::vec3 boundsMax = vertices[0].position;
+    for (const CoreVertex& vertex : vertices) {
+        boundsMin = glm::min(boundsMin, vertex.position);
+        boundsMax = glm::max(boundsMax, vertex.position);
+    }
+    Application::damage.addBounds(RenderInstance::model, boundsMin, boundsMax);
+
     Application::instance.renderToFramebuffer(vertices, program, 3, GL_TRIANGLES);
 }
 
@@ -50,4 +53,159 @@ void Triangle::setShader(Shader shader) {
     this->shader = shader;
 }
 
+static std::vector<glm::vec2> toVec2s(const std::vector<Point>& points) {
+    std::vector<glm::vec2> result;
+    result.reserve(points.size());
+    for (const Point& point : points) {
+        result.emplace_back(point.x, point.y);
+    }
+    return result;
+}
+
+Primitive::Primitive(std::string name, Color color, Position position, Shader shader) : Component(std::move(name)),
+    color(color),
+    position(position), shader(shader) {
+}
+
+CoreGeometry Primitive::tessellated() const {
+    return tessellate(levelOfDetail());
+}
+
+int Primitive::levelOfDetail() const {
+    glm::vec2 extent = curveExtent();
+    if (extent == glm::vec2(0.0f)) {
+        return 0;
+    }
+    return lodForPlacement(position.toVec3(), node, extent);
+}
+
+void Primitive::render() {
+    int lod = levelOfDetail();
+    TessellationKey key{kind(), lod, parameters()};
+    glm::vec4 rgba = color.toVec4();
+    key.parameters.insert(key.parameters.end(), {rgba.r, rgba.g, rgba.b, rgba.a});
+
+    const CoreMesh& mesh = Application::tessellationCache.get(key, [this, lod]() {
+        return tessellate(lod);
+    });
+
+    GLuint program = 0;
+    if (!Application::instance.usesIndirectBatch(shader)) {
+        program = Application::instance.getProgram(shader);
+    }
+
+    size_t draw = Application::instance.submitMesh(mesh, program, position.toVec3(), node);
+
+    // The size on screen changes with the node and the matrices, the mesh follows it from frame to frame
+    if (std::function<CoreGeometry(int)> tessellation = curveTessellation()) {
+        Application::tessellationCache.track({std::move(key), std::move(tessellation), position.toVec3(),
+                                              curveExtent(), node, draw});
+    }
+}
+
+void Primitive::setShader(Shader shader) {
+    this->shader = shader;
+}
+
+void Primitive::attachTo(TransformNode node) {
+    this->node = node;
+}
+
+Rectangle::Rectangle(std::string name, Color color, Size size, Position position, Shader shader) :
+    Primitive(std::move(name), color, position, shader), size(size) {
+}
+
+PrimitiveKind Rectangle::kind() const {
+    return PrimitiveKind::Rectangle;
+}
+
+std::vector<float> Rectangle::parameters() const {
+    return {size.width, size.height};
+}
+
+CoreGeometry Rectangle::tessellate(int) const {
+    return tessellateRectangle({size.width, size.height}, color.toVec4());
+}
 
+Ellipse::Ellipse(std::string name, Color color, Size radii, Position position, Shader shader) :
+    Primitive(std::move(name), color, position, shader), radii(radii) {
+}
+
+PrimitiveKind Ellipse::kind() const {
+    return PrimitiveKind::Ellipse;
+}
+
+std::vector<float> Ellipse::parameters() const {
+    return {radii.width, radii.height};
+}
+
+CoreGeometry Ellipse::tessellate(int lod) const {
+    return tessellateEllipse({radii.width, radii.height}, color.toVec4(), segmentsForLOD(lod));
+}
+
+glm::vec2 Ellipse::curveExtent() const {
+    return {radii.width, radii.height};
+}
+
+std::function<CoreGeometry(int)> Ellipse::curveTessellation() const {
+    return [radii = curveExtent(), rgba = color.toVec4()](int lod) {
+        return tessellateEllipse(radii, rgba, segmentsForLOD(lod));
+    };
+}
+
+Circle::Circle(std::string name, Color color, float radius, Position position, Shader shader) :
+    Ellipse(std::move(name), color, Size(radius, radius), position, shader) {
+}
+
+Polygon::Polygon(std::string name, Color color, std::vector<Point> points, Position position, Shader shader) :
+    Primitive(std::move(name), color, position, shader), points(std::move(points)) {
+}
+
+PrimitiveKind Polygon::kind() const {
+    return PrimitiveKind::Polygon;
+}
+
+std::vector<float> Polygon::parameters() const {
+    std::vector<float> result;
+    result.reserve(points.size() * 2);
+    for (const Point& point : points) {
+        result.insert(result.end(), {point.x, point.y});
+    }
+    return result;
+}
+
+CoreGeometry Polygon::tessellate(int) const {
+    return tessellatePolygon(toVec2s(points), color.toVec4());
+}
+
+Path::Path(std::string name, Color color, std::vector<Point> points, float thickness, Position position, bool closed,
+           Shader shader) : Primitive(std::move(name), color, position, shader), points(std::move(points)),
+                            thickness(thickness), closed(closed) {
+}
+
+PrimitiveKind Path::kind() const {
+    return PrimitiveKind::Path;
+}
+
+std::vector<float> Path::parameters() const {
+    std::vector<float> result;
+    result.reserve(points.size() * 2 + 2);
+    result.insert(result.end(), {thickness, closed ? 1.0f : 0.0f});
+    for (const Point& point : points) {
+        result.insert(result.end(), {point.x, point.y});
+    }
+    return result;
+}
+
+CoreGeometry Path::tessellate(int) const {
+    return tessellateStroke(toVec2s(points), thickness, closed, color.toVec4());
+}
+
+Sprite::Sprite(std::string name, std::string imageKey, std::shared_ptr<const Image> image, Size size,
+               Position position, Color tint) : Component(std::move(name)), imageKey(std::move(imageKey)),
+                                                image(std::move(image)), size(size), position(position), tint(tint) {
+}
+
+void Sprite::render() {
+    Application::spriteBatch.add({imageKey, image, position.toVec3(), {size.width, size.height}, tint.toVec4()});
+}
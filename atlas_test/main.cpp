@@ -20,5 +20,11 @@ int main() {
     Triangle triangle("Triangle", Color(255, 0, 0), Size(2, 2), Position(-1, -1));
     triangle.render();
 
+    Circle circle("Circle", Color(0, 0, 255), 0.25f, Position(0.5f, 0.5f));
+    circle.render();
+
+    Rectangle rectangle("Rectangle", Color(0, 255, 0), Size(0.4f, 0.2f), Position(-0.8f, 0.6f));
+    rectangle.render();
+
     application.run();
 }
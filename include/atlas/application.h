@@ -15,6 +15,14 @@
 
 #include "data.hpp"
 #include "core/core_rendering.h"
+#include "core/indirect_batch.h"
+#include "core/tessellation.h"
+#include "core/texture_atlas.h"
+#include "core/asset_loader.h"
+#include "core/transform.h"
+#include "core/frame_arena.h"
+#include "core/job_system.h"
+#include "core/damage.h"
 
 enum class AtlasBackend {
     OpenGL,
@@ -27,15 +35,31 @@ public:
     void setBackend(AtlasBackend backend);
     void mainLoop();
     void applyPostProcess(PostProcessUnit unit);
+    void addPostProcess(PostProcessUnit unit);
     AtlasBackend getBackend() const;
     static int width, height;
     std::string title;
+    // Set to false before setBackend to always use the OpenGL 3.3 path
+    bool preferOpenGL45 = true;
+    // Longest time the loop sleeps waiting for events when nothing needs to be drawn
+    int idleTimeoutMilliseconds = 100;
 
     Application(int width, int height, std::string title);
 
     static FunctionQueue<void> renderFunctions;
     static FunctionQueue<void> postProcessFunctions;
     static RenderInstance instance;
+    static IndirectMeshBatch indirectBatch;
+    static JobSystem jobs;
+    static TessellationCache tessellationCache;
+    static TextureAtlas textureAtlas;
+    static SpriteBatch spriteBatch;
+    static AssetLoader assetLoader;
+    static TransformHierarchy transforms;
+    static FrameArenaRing frameArenas;
+    // Only damaged regions are drawn again; changes the engine cannot see, like the contents of a
+    // custom render function, have to be reported with damage.add or damage.invalidate
+    static DamageTracker damage;
 
 private:
     SDL_Window* window = nullptr;
@@ -0,0 +1,109 @@
+/*
+* asset_loader.h
+* As part of the Atlas project
+* Created by Maxims Enterprise in 2024
+* --------------------------------------
+* Description: Asynchronous asset loading with staged GPU uploads
+* Copyright (c) 2024 Maxims Enterprise
+*/
+
+#ifndef ATLAS_ASSET_LOADER_H
+#define ATLAS_ASSET_LOADER_H
+
+#include <atomic>
+#include <string>
+#include <deque>
+#include <memory>
+#include <future>
+#include <chrono>
+#include <mutex>
+#include <functional>
+#include <stdexcept>
+#include <thread>
+#include <GL/glew.h>
+
+#include "atlas/graphics.h"
+#include "core_rendering.h"
+#include "tessellation.h"
+
+// Resolves once the asset is resident on the GPU, or holds the error that stopped it
+template <typename T>
+class AssetHandle {
+public:
+    AssetHandle() = default;
+
+    // uploadThread is the thread whose AssetLoader::pump() resolves the handle, if any
+    explicit AssetHandle(std::shared_future<T> future, std::thread::id uploadThread = std::thread::id())
+        : future(std::move(future)), uploadThread(uploadThread) {
+    }
+
+    bool isResident() const {
+        return future.valid() && future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    }
+
+    // Blocks until the asset is resident. On the render thread nothing could upload it while
+    // waiting, so calling it there before isResident() is true throws instead of never returning
+    const T& get() const {
+        if (uploadThread == std::this_thread::get_id() && !isResident()) {
+            throw std::logic_error("AssetHandle::get would wait forever on the thread that uploads the asset");
+        }
+        return future.get();
+    }
+
+    std::shared_future<T> future;
+    std::thread::id uploadThread;
+};
+
+struct ShaderAsset {
+    GLuint program = 0;
+};
+
+// Texture rows are uploaded in file order, so the first row of the image is at t = 0
+struct TextureAsset {
+    GLuint texture = 0;
+    int width = 0;
+    int height = 0;
+};
+
+// Images are read as binary PPM (P6) or PAM (P7, RGB or RGB_ALPHA) with one byte per sample,
+// converted to RGBA8
+Image decodeImage(const std::string& path);
+
+// Reads and decodes files as jobs on the engine job system, then uploads them on the render
+// thread within a time budget per frame so that loading never stalls a frame
+class AssetLoader {
+public:
+    AssetHandle<ShaderAsset> loadShader(std::string vertexPath, std::string fragmentPath);
+    AssetHandle<TextureAsset> loadTexture(std::string path);
+    // Meshes are scene files written by SceneBaker, with all their shapes merged into one mesh
+    AssetHandle<CoreMesh> loadMesh(std::string path);
+    // Images only need decoding, so they resolve without going through the upload queue
+    AssetHandle<std::shared_ptr<const Image>> loadImage(std::string path);
+
+    void pump();
+    void shutdown();
+    size_t pendingUploads();
+
+    double uploadBudgetMilliseconds = 2.0;
+    // Size of one staging pixel buffer; larger textures are uploaded over several steps
+    size_t stagingBufferSize = 4 * 1024 * 1024;
+
+private:
+    // An upload step runs on the render thread and returns true once the asset is resident
+    using UploadStep = std::function<bool()>;
+
+    std::deque<UploadStep> uploads;
+    std::mutex uploadMutex;
+    // The engine is set up and pumped on the same thread, so the one that builds the loader
+    // stands in for the render thread until the first pump
+    std::atomic<std::thread::id> renderThread{std::this_thread::get_id()};
+
+    GLuint stagingBuffers[3] = {0, 0, 0};
+    unsigned int nextStagingBuffer = 0;
+
+    void submitDecode(std::function<void()> job);
+    void submitUpload(UploadStep step);
+    GLuint acquireStagingBuffer();
+};
+
+#endif //ATLAS_ASSET_LOADER_H
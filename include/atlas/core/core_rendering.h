@@ -10,19 +10,42 @@
 #ifndef ATLAS_CORE_RENDERING_H
 #define ATLAS_CORE_RENDERING_H
 
+#include <array>
+#include <deque>
 #include <vector>
 #include <glm/glm.hpp>
 #include <GL/glew.h>
 #include <OpenGL/gl.h>
 #include <functional>
+#include <string>
+#include <unordered_map>
 
 #include "atlas/graphics.h"
+#include "transform.h"
+#include "damage.h"
+#include "post_processing.h"
 
 struct CoreVertex {
     glm::vec3 position;
     glm::vec4 color;
 };
 
+struct CoreMesh {
+    GLuint vao = 0;
+    GLuint vbo = 0;
+    GLuint ebo = 0;
+    GLsizei indexCount = 0;
+    GLenum mode = GL_TRIANGLES;
+    // Pooled meshes share buffers they do not own and start at these offsets
+    GLuint firstIndex = 0;
+    GLint baseVertex = 0;
+    bool pooled = false;
+    // Box around the vertices, used to locate the screen area a draw of the mesh damages. It is
+    // filled by whoever knows the geometry, uploads do not go over the vertices again
+    glm::vec3 boundsMin = glm::vec3(0.0f);
+    glm::vec3 boundsMax = glm::vec3(0.0f);
+};
+
 struct CoreRenderingPackage {
     GLuint program;
     GLuint vao;
@@ -34,34 +57,128 @@ struct CoreRenderingPackage {
 class RenderInstance {
 public:
     GLuint getProgramFromLocal(const char* vertexShader, const char* fragmentShader);
+    GLuint getProgramFromSource(const std::string& vertexSource, const std::string& fragmentSource);
     GLuint getProgramFromShader(AtlasShader shader);
+    GLuint getComputeProgramFromLocal(const char* computeShader);
+    // Compiled the first time a built-in shader or a pair of shader files is used, then shared
+    GLuint getProgram(const Shader& shader);
+    static const std::string& getAtlasRoot();
     void createFramebuffer(int width, int height);
 
     static glm::mat4 model;
     static glm::mat4 view;
     static glm::mat4 projection;
 
-    void renderToScreen(std::vector<CoreVertex> vertices, GLuint program, int count, GLenum mode);
-    void renderToFramebuffer(std::vector<CoreVertex> vertices, GLuint program, int count, GLenum mode);
+    void renderToScreen(const std::vector<CoreVertex>& vertices, GLuint program, int count, GLenum mode);
+    void renderToFramebuffer(const std::vector<CoreVertex>& vertices, GLuint program, int count, GLenum mode);
+    void renderMeshToFramebuffer(const CoreMesh& mesh, GLuint program, glm::vec3 offset,
+                                 TransformNode node = ATLAS_NO_TRANSFORM);
+    CoreMesh uploadMesh(const std::vector<CoreVertex>& vertices, const std::vector<GLuint>& indices, GLenum mode) {
+        return uploadMesh(vertices.data(), vertices.size(), indices.data(), indices.size(), mode);
+    }
+    // Uploads straight from memory the caller owns, such as a mapped scene file
+    CoreMesh uploadMesh(const CoreVertex* vertices, size_t vertexCount, const GLuint* indices, size_t indexCount,
+                        GLenum mode);
+    void destroyMesh(CoreMesh& mesh);
+    // Queues a mesh for every frame and damages the area it covers. A program of 0 draws it
+    // through the indirect batch, see usesIndirectBatch. Returns the draw for replaceMesh
+    size_t submitMesh(const CoreMesh& mesh, GLuint program, glm::vec3 offset, TransformNode node = ATLAS_NO_TRANSFORM);
+    // Draws another mesh in place of a submitted one from the next frame on, like a new level of detail
+    void replaceMesh(size_t draw, const CoreMesh& mesh);
+    bool usesIndirectBatch(const Shader& shader) const;
+    // Called once per damaged region, each followed by the render functions
+    void beginFrame(const DamageRect& region);
+    void endFrame(const std::vector<DamageRect>& regions);
     void createPongBuffers(int width, int height);
+    // Padding damaged regions need so that post-processing picks up every changed pixel.
+    // Planned again only when the chain changes, since it is read on every damaged frame
+    int getPostProcessSpread() const {
+        return postProcessSpread;
+    }
 
-    RenderInstance() : packages({}), postProcessUnit(PostProcessUnit(AtlasPostProcessing::None)) {
+    void setPostProcess(PostProcessUnit unit);
+    void addPostProcess(PostProcessUnit unit);
+    void clearPostProcess();
+
+    const std::vector<PostProcessUnit>& getPostProcessChain() const {
+        return postProcessChain;
     }
 
-    PostProcessUnit postProcessUnit;
+    // Stands in for the single post-processing unit that chains replaced: assigning a unit
+    // replaces the whole chain with it, reading gives the first unit of the chain
+    class PostProcessUnitAlias {
+    public:
+        explicit PostProcessUnitAlias(RenderInstance& owner) : owner(owner) {
+        }
+
+        PostProcessUnitAlias(const PostProcessUnitAlias&) = delete;
+
+        [[deprecated("Use setPostProcess or addPostProcess")]]
+        PostProcessUnitAlias& operator=(PostProcessUnit unit);
+        [[deprecated("Use getPostProcessChain")]]
+        operator PostProcessUnit() const;
+
+    private:
+        RenderInstance& owner;
+    };
+
+    PostProcessUnitAlias postProcessUnit{*this};
+
+    // Set when the context is OpenGL 4.5: resources use direct state access and immutable storage,
+    // default shapes are drawn with multi-draw indirect and the blur runs as a compute shader
+    bool directStateAccess = false;
+
+    RenderInstance() : packages({}) {
+    }
 
 private:
+    struct LocalProgram {
+        std::string vertexShader;
+        std::string fragmentShader;
+        GLuint program;
+    };
+
+    // Mesh of every submitted draw, and its command in the indirect batch when it has one
+    struct SubmittedDraw {
+        CoreMesh mesh;
+        size_t command;
+    };
+
     std::vector<CoreRenderingPackage> packages;
-    GLuint framebuffers[2];
-    GLuint textures[2];
-    GLuint depthBuffer;
+    // A deque keeps the meshes in place, render functions read them every frame
+    std::deque<SubmittedDraw> submittedDraws;
+    // Indexed by AtlasShader
+    std::array<GLuint, 2> shaderPrograms = {0, 0};
+    std::vector<LocalProgram> localPrograms;
+    GLuint sceneFramebuffer = 0;
+    GLuint sceneTexture = 0;
+    GLuint depthBuffer = 0;
+    GLuint pongFramebuffers[2] = {0, 0};
+    GLuint pongTextures[2] = {0, 0};
 
     GLuint quadVBO = 0;
     GLuint quadVAO = 0;
+    // The last pass always covers the whole window
+    std::vector<DamageRect> screenRegion = {DamageRect{}};
 
-    void applyAnyFramebufferEffect(GLuint texture);
+    // The chain is planned into passes when it changes; programs are cached by pass signature
+    std::vector<PostProcessUnit> postProcessChain;
+    std::vector<PostProcessPass> postProcessPasses;
+    bool postProcessDirty = true;
+    int postProcessSpread = 0;
+    std::unordered_map<std::string, GLuint> postProcessPrograms;
+    GLuint blurProgram = 0;
+    GLuint computeBlurProgram = 0;
 
-    void applyBlurEffect(GLuint texture);
+    void buildPostProcessPasses();
+    void createQuad();
+    void createTarget(int width, int height, GLuint& framebuffer, GLuint& texture);
+    void drawPostProcessPass(const PostProcessPass& pass, GLuint texture, GLuint framebuffer,
+                             const std::vector<DamageRect>& regions, int padding);
+    void applyBlurEffect(const PostProcessPass& pass, GLuint texture, const std::vector<DamageRect>& regions,
+                         int padding);
+    void applyComputeBlurEffect(const PostProcessPass& pass, GLuint texture, const std::vector<DamageRect>& regions,
+                                int padding);
 };
 
 #endif //ATLAS_CORE_RENDERING_H
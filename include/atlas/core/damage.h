@@ -0,0 +1,86 @@
+/*
+* damage.h
+* As part of the Atlas project
+* Created by Maxims Enterprise in 2024
+* --------------------------------------
+* Description: Damaged screen regions between frames
+* Copyright (c) 2024 Maxims Enterprise
+*/
+
+#ifndef ATLAS_DAMAGE_H
+#define ATLAS_DAMAGE_H
+
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "transform.h"
+
+// Rectangle in window pixels with the origin at the bottom left, like glScissor
+struct DamageRect {
+    int x = 0;
+    int y = 0;
+    int width = 0;
+    int height = 0;
+
+    bool empty() const {
+        return width <= 0 || height <= 0;
+    }
+
+    DamageRect padded(int horizontal, int vertical) const;
+    DamageRect clamped(int screenWidth, int screenHeight) const;
+    DamageRect merged(const DamageRect& other) const;
+    bool overlaps(const DamageRect& other) const;
+};
+
+// Collects the parts of the screen that changed since the last presented frame. Nothing
+// is drawn while it stays empty; the first frame and anything it cannot locate damage
+// the whole screen
+class DamageTracker {
+public:
+    void add(DamageRect rect);
+    // Damages the screen area covered by a box, with transform applied before the view and projection
+    void addBounds(const glm::mat4& transform, glm::vec3 min, glm::vec3 max);
+    void invalidate();
+
+    // Shapes attached to a transform node damage their old and new area whenever the node moves
+    void track(TransformNode node, glm::vec3 min, glm::vec3 max);
+    void nodesMoved(const std::vector<TransformNode>& nodes);
+    // Damages everything when the global model, view or projection matrix changed, and
+    // returns whether they did
+    bool checkMatrices();
+
+    bool isDamaged() const {
+        return full || !rects.empty();
+    }
+
+    // Pads the damage, clamps it to the screen and merges it into disjoint regions, then resets.
+    // A negative padding means the damage cannot be bounded and returns the whole screen. The
+    // regions stay valid until the next call, which reuses their storage
+    const std::vector<DamageRect>& collect(int padding, int screenWidth, int screenHeight);
+    void clear();
+
+    // More regions than this are replaced by their bounding rectangle
+    size_t maxRegions = 4;
+
+private:
+    struct TrackedBounds {
+        TransformNode node;
+        glm::vec3 min;
+        glm::vec3 max;
+        DamageRect last;
+    };
+
+    std::vector<DamageRect> rects;
+    std::vector<DamageRect> regions;
+    std::vector<TrackedBounds> tracked;
+    std::vector<std::vector<size_t>> trackedByNode;
+    glm::mat4 lastModel = glm::mat4(1.0f);
+    glm::mat4 lastView = glm::mat4(1.0f);
+    glm::mat4 lastProjection = glm::mat4(1.0f);
+    bool full = true;
+
+    bool project(const glm::mat4& transform, glm::vec3 min, glm::vec3 max, DamageRect& rect) const;
+    DamageRect projectTracked(const TrackedBounds& bounds);
+};
+
+#endif //ATLAS_DAMAGE_H
@@ -0,0 +1,108 @@
+/*
+* frame_arena.h
+* As part of the Atlas project
+* Created by Maxims Enterprise in 2024
+* --------------------------------------
+* Description: Per-frame linear allocator for transient render data
+* Copyright (c) 2024 Maxims Enterprise
+*/
+
+#ifndef ATLAS_FRAME_ARENA_H
+#define ATLAS_FRAME_ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+constexpr int ATLAS_FRAMES_IN_FLIGHT = 2;
+
+// Bump allocator that is reset once per frame. Allocations that do not fit go to the
+// heap for the rest of the frame, and the block grows to the peak on the next reset,
+// so a steady-state frame never touches the heap
+class FrameArena {
+public:
+    explicit FrameArena(size_t capacity = 1024 * 1024);
+
+    void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+    void reset();
+
+    size_t used() const {
+        return offset + overflowBytes;
+    }
+
+    size_t peak() const {
+        return peakBytes;
+    }
+
+    size_t capacity() const {
+        return capacityBytes;
+    }
+
+    // Number of times the arena itself had to allocate from the heap
+    size_t heapAllocations() const {
+        return heapAllocationCount;
+    }
+
+private:
+    std::unique_ptr<std::byte[]> block;
+    size_t capacityBytes;
+    size_t offset = 0;
+    size_t peakBytes = 0;
+    size_t heapAllocationCount = 0;
+
+    std::vector<std::unique_ptr<std::byte[]>> overflow;
+    size_t overflowBytes = 0;
+};
+
+// One arena per frame in flight, so data from the previous frame stays valid while it is consumed
+class FrameArenaRing {
+public:
+    FrameArena& current() {
+        return arenas[index];
+    }
+
+    void nextFrame() {
+        index = (index + 1) % ATLAS_FRAMES_IN_FLIGHT;
+        arenas[index].reset();
+    }
+
+    size_t peak() const;
+    size_t heapAllocations() const;
+
+private:
+    FrameArena arenas[ATLAS_FRAMES_IN_FLIGHT];
+    int index = 0;
+};
+
+// STL adapter: memory is only given back when the arena is reset
+template <typename T>
+class ArenaAllocator {
+public:
+    using value_type = T;
+
+    explicit ArenaAllocator(FrameArena& arena) : arena(&arena) {
+    }
+
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {
+    }
+
+    T* allocate(size_t count) {
+        return static_cast<T*>(arena->allocate(count * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T*, size_t) {
+    }
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>& other) const {
+        return arena == other.arena;
+    }
+
+    FrameArena* arena;
+};
+
+template <typename T>
+using FrameVector = std::vector<T, ArenaAllocator<T>>;
+
+#endif //ATLAS_FRAME_ARENA_H
@@ -0,0 +1,86 @@
+/*
+* indirect_batch.h
+* As part of the Atlas project
+* Created by Maxims Enterprise in 2024
+* --------------------------------------
+* Description: Pooled meshes drawn with multi-draw indirect on OpenGL 4.5
+* Copyright (c) 2024 Maxims Enterprise
+*/
+
+#ifndef ATLAS_INDIRECT_BATCH_H
+#define ATLAS_INDIRECT_BATCH_H
+
+#include <vector>
+#include <glm/glm.hpp>
+#include <GL/glew.h>
+
+#include "transform.h"
+
+struct CoreVertex;
+struct CoreMesh;
+
+// Layout expected by glMultiDrawElementsIndirect
+struct DrawElementsIndirectCommand {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+// Read by the vertex shader as a per-instance attribute: the offset, then the transform node
+struct IndirectDrawData {
+    glm::vec3 offset;
+    float transformIndex;
+};
+
+// Keeps every mesh in one pair of immutable vertex and index buffers, so that the shapes
+// using the default shader are drawn with as few indirect calls as possible. Shapes keep the
+// order they were submitted in: consecutive ones share a call, anything else queued in between
+// starts a new one
+class IndirectMeshBatch {
+public:
+    CoreMesh allocate(const CoreVertex* vertices, size_t vertexCount, const GLuint* indices, size_t indexCount,
+                      GLenum mode);
+    // Returns the index of the command drawing the mesh
+    size_t add(const CoreMesh& mesh, glm::vec3 offset, TransformNode node);
+    // Points a command at another mesh of the pool
+    void replace(size_t command, const CoreMesh& mesh);
+    void clear();
+
+private:
+    GLuint vao = 0;
+    GLuint vertexBuffer = 0;
+    GLuint indexBuffer = 0;
+    GLuint drawBuffer = 0;
+    GLuint commandBuffer = 0;
+    GLuint program = 0;
+
+    size_t vertexCapacity = 0;
+    size_t verticesUsed = 0;
+    size_t indexCapacity = 0;
+    size_t indicesUsed = 0;
+    size_t commandCapacity = 0;
+    size_t drawCapacity = 0;
+
+    // Consecutive commands drawn by one render function
+    struct DrawRun {
+        size_t firstCommand;
+        size_t commandCount;
+    };
+
+    std::vector<DrawElementsIndirectCommand> commands;
+    std::vector<IndirectDrawData> draws;
+    std::vector<DrawRun> runs;
+    // Size of the render queue right after the last run was queued
+    size_t queuedFunctions = 0;
+    // Counts clears, so that runs queued before one draw nothing afterwards
+    unsigned int generation = 0;
+    bool dirty = false;
+
+    void draw(size_t run, unsigned int runGeneration);
+    void createVertexArray();
+    void reserve(GLuint& buffer, size_t& capacity, size_t used, size_t needed, size_t elementSize);
+};
+
+#endif //ATLAS_INDIRECT_BATCH_H
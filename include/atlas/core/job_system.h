@@ -0,0 +1,129 @@
+/*
+* job_system.h
+* As part of the Atlas project
+* Created by Maxims Enterprise in 2024
+* --------------------------------------
+* Description: Work-stealing job system shared by the engine and its users
+* Copyright (c) 2024 Maxims Enterprise
+*/
+
+#ifndef ATLAS_JOB_SYSTEM_H
+#define ATLAS_JOB_SYSTEM_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Counts the unfinished jobs of a fork-join group; waiting on it returns once it reaches zero
+using JobCounter = std::atomic<int>;
+
+struct JobWorkerStats {
+    size_t jobsExecuted;
+    size_t jobsStolen;
+    // Share of the time since the last reset that the worker spent running jobs
+    double utilization;
+};
+
+// Fixed pool of workers, each with its own deque. A worker takes the newest job of its
+// own deque and steals the oldest job of another one when it runs out of work. Waiting on
+// a counter only helps with the jobs of that counter, so a render thread waiting on its own
+// fork-join group never picks up unrelated work such as asset decoding
+class JobSystem {
+public:
+    // A worker count of 0 uses one worker per hardware thread, minus the main thread
+    explicit JobSystem(unsigned int workerCount = 0);
+    ~JobSystem();
+
+    void submit(std::function<void()> job, JobCounter* counter = nullptr);
+    void wait(JobCounter& counter);
+    void shutdown();
+
+    // Runs function(chunkBegin, chunkEnd) over [begin, end) in chunks of grain elements
+    // and returns when all chunks are done. A grain of 0 picks one from the worker count
+    template <typename Function>
+    void parallelFor(size_t begin, size_t end, size_t grain, const Function& function) {
+        if (end <= begin) {
+            return;
+        }
+        if (grain == 0) {
+            size_t chunks = static_cast<size_t>(getWorkerCount() + 1) * 4;
+            grain = std::max<size_t>(1, (end - begin + chunks - 1) / chunks);
+        }
+
+        // Each job only captures a pointer and its chunk start, which std::function stores without
+        // allocating, so a parallelFor makes no heap allocations once the queues have grown
+        struct Range {
+            const Function* function;
+            size_t end;
+            size_t grain;
+        } range{&function, end, grain};
+
+        JobCounter counter(0);
+        for (size_t chunk = begin; chunk < end; chunk += grain) {
+            submit([range = &range, chunk]() {
+                (*range->function)(chunk, std::min(chunk + range->grain, range->end));
+            }, &counter);
+        }
+        wait(counter);
+    }
+
+    unsigned int getWorkerCount() const {
+        return workerCount;
+    }
+
+    std::vector<JobWorkerStats> getStats() const;
+    void resetStats();
+
+private:
+    struct Job {
+        std::function<void()> function;
+        JobCounter* counter = nullptr;
+    };
+
+    // Ring buffer that only grows, so a steady stream of jobs never touches the heap. Pops can
+    // skip the jobs that do not belong to a given counter
+    struct WorkQueue {
+        std::mutex mutex;
+        std::vector<Job> slots;
+        size_t head = 0;
+        size_t count = 0;
+
+        void push(Job job);
+        bool popNewest(Job& job, const JobCounter* only);
+        bool popOldest(Job& job, const JobCounter* only);
+    };
+
+    struct WorkerCounters {
+        std::atomic<size_t> jobsExecuted{0};
+        std::atomic<size_t> jobsStolen{0};
+        std::atomic<long long> busyNanoseconds{0};
+    };
+
+    unsigned int workerCount;
+    // One queue per worker, plus a last one shared by every thread that is not a worker
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    std::vector<std::unique_ptr<WorkerCounters>> counters;
+    std::vector<std::thread> workers;
+    std::chrono::steady_clock::time_point statsStart = std::chrono::steady_clock::now();
+
+    std::mutex startMutex;
+    std::mutex sleepMutex;
+    std::condition_variable sleepCondition;
+    std::atomic<int> queuedJobs{0};
+    std::atomic<bool> started{false};
+    std::atomic<bool> stopping{false};
+
+    void start();
+    void workerLoop(unsigned int index);
+    // Runs one job, only one counted by `only` when it is set
+    bool runOne(unsigned int self, const JobCounter* only);
+    unsigned int currentQueue() const;
+};
+
+#endif //ATLAS_JOB_SYSTEM_H
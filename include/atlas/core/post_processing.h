@@ -0,0 +1,54 @@
+/*
+* post_processing.h
+* As part of the Atlas project
+* Created by Maxims Enterprise in 2024
+* --------------------------------------
+* Description: Post-processing chains and pass fusion
+* Copyright (c) 2024 Maxims Enterprise
+*/
+
+#ifndef ATLAS_POST_PROCESSING_H
+#define ATLAS_POST_PROCESSING_H
+
+#include <string>
+#include <vector>
+#include <GL/glew.h>
+
+#include "atlas/graphics.h"
+
+// The blur alternates horizontal and vertical passes of this radius in pixels
+constexpr int ATLAS_BLUR_ITERATIONS = 10;
+constexpr int ATLAS_BLUR_RADIUS = 4;
+
+enum class PostProcessPassKind {
+    // Consecutive pointwise effects combined into one generated shader
+    Fused,
+    Blur,
+    // Effect with its own vertex and fragment shader files
+    Local,
+};
+
+struct PostProcessPass {
+    PostProcessPassKind kind = PostProcessPassKind::Fused;
+    GLuint program = 0;
+    // Indices into the post-processing chain of the effects this pass runs
+    std::vector<size_t> units;
+    // Location of the parameters of each fused effect
+    std::vector<GLint> parameterLocations;
+    // Result of every pass but the last, kept between frames so that only damaged regions are redone
+    GLuint framebuffer = 0;
+    GLuint texture = 0;
+};
+
+// Splits a chain into passes: only effects that read neighbouring pixels start a new one.
+// The last pass always writes to the screen, so it is never a blur
+std::vector<PostProcessPass> planPostProcessPasses(const std::vector<PostProcessUnit>& chain);
+
+// How far, in pixels, a change in the scene can spread through the passes; -1 when unknown
+int getPostProcessSpread(const std::vector<PostProcessUnit>& chain);
+int getPassSpread(const PostProcessPass& pass);
+
+std::string getFusedSignature(const std::vector<PostProcessUnit>& chain, const std::vector<size_t>& units);
+std::string generateFusedShader(const std::vector<PostProcessUnit>& chain, const std::vector<size_t>& units);
+
+#endif //ATLAS_POST_PROCESSING_H
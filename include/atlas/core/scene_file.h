@@ -0,0 +1,154 @@
+/*
+* scene_file.h
+* As part of the Atlas project
+* Created by Maxims Enterprise in 2024
+* --------------------------------------
+* Description: Baked scene files mapped straight into GPU buffers
+* Copyright (c) 2024 Maxims Enterprise
+*/
+
+#ifndef ATLAS_SCENE_FILE_H
+#define ATLAS_SCENE_FILE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include <GL/glew.h>
+
+#include "atlas/graphics.h"
+#include "core_rendering.h"
+#include "tessellation.h"
+#include "transform.h"
+
+class Primitive;
+class Triangle;
+
+constexpr char ATLAS_SCENE_MAGIC[4] = {'A', 'S', 'C', 'N'};
+constexpr uint32_t ATLAS_SCENE_VERSION = 2;
+
+// A scene file is this header followed by its sections, each at a 16 byte aligned offset.
+// Values are stored in the byte order of the machine that baked them, vertices and indices
+// exactly as the GPU reads them
+struct SceneFileHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t programCount;
+    uint32_t nodeCount;
+    uint32_t shapeCount;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t stringBytes;
+    uint64_t programsOffset;
+    uint64_t nodesOffset;
+    uint64_t shapesOffset;
+    uint64_t verticesOffset;
+    uint64_t indicesOffset;
+    uint64_t stringsOffset;
+};
+
+// Built-in shader, or vertex and fragment files; paths are offsets into the string section
+struct SceneProgramRecord {
+    uint32_t local;
+    uint32_t shader;
+    uint32_t vertexPath;
+    uint32_t fragmentPath;
+};
+
+// Transform node, always stored after its parent
+struct SceneNodeRecord {
+    int32_t parent;
+    float local[16];
+};
+
+// One draw: a range of the index section, whose indices start at baseVertex and stay
+// below vertexCount
+struct SceneShapeRecord {
+    uint32_t name;
+    uint32_t program;
+    uint32_t mode;
+    uint32_t firstIndex;
+    int32_t baseVertex;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    int32_t node;
+    float offset[3];
+    float boundsMin[3];
+    float boundsMax[3];
+};
+
+static_assert(sizeof(CoreVertex) == 28, "Baked vertices must keep the layout of CoreVertex");
+static_assert(sizeof(SceneFileHeader) == 80 && sizeof(SceneProgramRecord) == 16 && sizeof(SceneNodeRecord) == 68 &&
+              sizeof(SceneShapeRecord) == 68, "Scene records must not be padded");
+
+// Records shapes as they would be drawn now, tessellated at their current level of detail,
+// and writes them as a scene file. Shapes attached to transform nodes bring the whole hierarchy
+class SceneBaker {
+public:
+    void add(const Primitive& primitive);
+    void add(const Triangle& triangle);
+    // Geometry made elsewhere, like imported meshes, is stored at the origin without a transform
+    void add(const std::string& name, const CoreGeometry& geometry, Shader shader = Shader(AtlasShader::Default));
+    bool write(const std::string& path) const;
+
+    size_t size() const {
+        return shapes.size();
+    }
+
+private:
+    std::vector<SceneProgramRecord> programs;
+    // Identifies each program so that shapes sharing a shader share its record
+    std::vector<std::string> programKeys;
+    std::vector<SceneShapeRecord> shapes;
+    std::vector<CoreVertex> vertices;
+    std::vector<GLuint> indices;
+    std::string strings;
+    bool usesTransforms = false;
+
+    void addShape(const std::string& name, const CoreGeometry& geometry, const Shader& shader, glm::vec3 offset,
+                  TransformNode node);
+    uint32_t addProgram(const Shader& shader);
+    uint32_t addString(const std::string& string);
+};
+
+// Scene file mapped into memory. Opening only checks the header and the ranges of the
+// sections; render() uploads all vertices and indices in one go straight from the mapping,
+// then queues every shape. The GPU buffers live as long as the engine, like cached meshes.
+// getGeometry() instead merges the shapes on the CPU, for scenes loaded as a single mesh
+class BakedScene {
+public:
+    explicit BakedScene(const std::string& path);
+    ~BakedScene();
+
+    BakedScene(const BakedScene&) = delete;
+    BakedScene& operator=(const BakedScene&) = delete;
+
+    void render();
+    // Every shape with its offset and transform node applied, in one indexed triangle list
+    CoreGeometry getGeometry() const;
+
+    size_t size() const {
+        return header->shapeCount;
+    }
+
+    std::string getShapeName(size_t shape) const;
+
+private:
+    const unsigned char* data = nullptr;
+    size_t byteSize = 0;
+    // Platforms without mmap read the file into this buffer instead
+    std::vector<unsigned char> buffer;
+
+    const SceneFileHeader* header = nullptr;
+    const SceneProgramRecord* programRecords = nullptr;
+    const SceneNodeRecord* nodeRecords = nullptr;
+    const SceneShapeRecord* shapeRecords = nullptr;
+    const CoreVertex* vertices = nullptr;
+    const GLuint* indices = nullptr;
+    const char* strings = nullptr;
+
+    void validate(const std::string& path);
+    void unmap();
+};
+
+#endif //ATLAS_SCENE_FILE_H
@@ -0,0 +1,101 @@
+/*
+* tessellation.h
+* As part of the Atlas project
+* Created by Maxims Enterprise in 2024
+* --------------------------------------
+* Description: Tessellation of primitives into indexed meshes
+* Copyright (c) 2024 Maxims Enterprise
+*/
+
+#ifndef ATLAS_TESSELLATION_H
+#define ATLAS_TESSELLATION_H
+
+#include <vector>
+#include <functional>
+#include <unordered_map>
+#include <glm/glm.hpp>
+
+#include "core_rendering.h"
+
+enum class PrimitiveKind {
+    Rectangle,
+    Ellipse,
+    Polygon,
+    Path,
+};
+
+// Geometry produced on the CPU, before it is uploaded as a CoreMesh
+struct CoreGeometry {
+    std::vector<CoreVertex> vertices;
+    std::vector<GLuint> indices;
+};
+
+// Identifies a tessellation: two shapes with the same key share one GPU mesh
+struct TessellationKey {
+    PrimitiveKind kind;
+    int lod;
+    std::vector<float> parameters;
+
+    bool operator==(const TessellationKey& other) const = default;
+};
+
+struct TessellationKeyHash {
+    size_t operator()(const TessellationKey& key) const;
+};
+
+// Levels of detail go from 0 (8 segments) to ATLAS_MAX_LOD (256 segments)
+constexpr int ATLAS_MAX_LOD = 5;
+// Longest miter allowed on stroke joins, relative to half of the thickness
+constexpr float ATLAS_MITER_LIMIT = 4.0f;
+
+int segmentsForLOD(int lod);
+int lodForScreenRadius(float pixels);
+float screenSpaceRadius(const glm::mat4& transform, glm::vec2 halfExtent);
+// Level of detail of a curve with this half extent, placed at position on an optional node
+int lodForPlacement(glm::vec3 position, TransformNode node, glm::vec2 halfExtent);
+
+void computeBounds(const CoreGeometry& geometry, CoreMesh& mesh);
+
+CoreGeometry tessellateRectangle(glm::vec2 size, glm::vec4 color);
+CoreGeometry tessellateEllipse(glm::vec2 radii, glm::vec4 color, int segments);
+CoreGeometry tessellatePolygon(const std::vector<glm::vec2>& points, glm::vec4 color);
+CoreGeometry tessellateStroke(const std::vector<glm::vec2>& points, float thickness, bool closed, glm::vec4 color);
+
+// Submitted draw of a curved shape. It keeps a copy of everything needed to tessellate the
+// shape again, so the level of detail can follow its size on screen after the shape is gone
+struct AdaptiveDraw {
+    TessellationKey key;
+    std::function<CoreGeometry(int)> tessellate;
+    glm::vec3 position;
+    glm::vec2 halfExtent;
+    TransformNode node;
+    // Returned by RenderInstance::submitMesh
+    size_t draw;
+};
+
+class TessellationCache {
+public:
+    const CoreMesh& get(const TessellationKey& key, const std::function<CoreGeometry()>& tessellate);
+    void clear();
+
+    void track(AdaptiveDraw draw);
+    // Picks the level of detail again for draws on moved nodes, or for every draw when the
+    // matrices or the window changed, and swaps in the mesh of the new level
+    void updateLevels(const std::vector<TransformNode>& movedNodes, bool viewChanged);
+
+    size_t size() const {
+        return meshes.size();
+    }
+
+    size_t hits = 0;
+    size_t misses = 0;
+
+private:
+    std::unordered_map<TessellationKey, CoreMesh, TessellationKeyHash> meshes;
+    std::vector<AdaptiveDraw> adaptive;
+    std::vector<std::vector<size_t>> adaptiveByNode;
+
+    void updateLevel(AdaptiveDraw& draw);
+};
+
+#endif //ATLAS_TESSELLATION_H
@@ -0,0 +1,175 @@
+/*
+* texture_atlas.h
+* As part of the Atlas project
+* Created by Maxims Enterprise in 2024
+* --------------------------------------
+* Description: Runtime texture atlas packing and sprite batching
+* Copyright (c) 2024 Maxims Enterprise
+*/
+
+#ifndef ATLAS_TEXTURE_ATLAS_H
+#define ATLAS_TEXTURE_ATLAS_H
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <unordered_map>
+#include <glm/glm.hpp>
+#include <GL/glew.h>
+
+#include "atlas/graphics.h"
+#include "atlas/units.h"
+
+struct AtlasRect {
+    int x, y, width, height;
+};
+
+// Bottom-left skyline packer: keeps the top edge of the packed area as a list of segments
+class SkylinePacker {
+public:
+    SkylinePacker(int width, int height);
+    bool insert(int width, int height, AtlasRect& result);
+    void reset();
+    float occupancy() const;
+
+private:
+    struct SkylineNode {
+        int x, y, width;
+    };
+
+    int width, height;
+    long usedArea = 0;
+    std::vector<SkylineNode> skyline;
+
+    int fit(size_t index, int width, int height) const;
+};
+
+struct AtlasRegion {
+    int page;
+    glm::vec2 uvMin;
+    glm::vec2 uvMax;
+};
+
+// Decides where images go in the atlas pages without touching the GPU: packs them with their
+// padding, remembers their regions and picks the page to evict when every page is full
+class AtlasLayout {
+public:
+    AtlasLayout(int pageSize, int padding, int maxPages);
+
+    const AtlasRegion* find(const std::string& key);
+    // Places an image, adding or evicting a page if needed. rect is the padded area to fill
+    const AtlasRegion* place(const std::string& key, int width, int height, AtlasRect& rect);
+    void nextFrame();
+    void clear();
+
+    size_t pageCount() const {
+        return pages.size();
+    }
+
+    float occupancy(int page) const {
+        return pages[page].packer.occupancy();
+    }
+
+    int getPageSize() const {
+        return pageSize;
+    }
+
+    int getPadding() const {
+        return padding;
+    }
+
+    // Increased every time a page is evicted, so users know their regions may be gone
+    unsigned long evictions = 0;
+
+private:
+    struct LayoutPage {
+        SkylinePacker packer;
+        unsigned long lastUsed;
+        std::vector<std::string> keys;
+    };
+
+    int pageSize, padding, maxPages;
+    unsigned long frame = 0;
+    std::vector<LayoutPage> pages;
+    std::unordered_map<std::string, AtlasRegion> regions;
+
+    int chooseEvictedPage() const;
+    void evictPage(int page);
+};
+
+// Packs images into shared RGBA8 pages. When every page is full, the least recently
+// used page is evicted and its images have to be added again
+class TextureAtlas {
+public:
+    explicit TextureAtlas(int pageSize = 1024, int padding = 1, int maxPages = 4);
+
+    const AtlasRegion* find(const std::string& key);
+    const AtlasRegion* add(const std::string& key, const Image& image);
+    // Called once per main loop iteration; pages used since then are not evicted
+    void nextFrame();
+    void clear();
+
+    GLuint getPageTexture(int page) const;
+
+    size_t pageCount() const {
+        return layout.pageCount();
+    }
+
+    unsigned long evictions() const {
+        return layout.evictions;
+    }
+
+private:
+    AtlasLayout layout;
+    std::vector<GLuint> textures;
+
+    void createPage();
+    void upload(GLuint texture, const AtlasRect& rect, const Image& image) const;
+};
+
+struct SpriteVertex {
+    glm::vec3 position;
+    glm::vec2 uv;
+    glm::vec4 color;
+};
+
+struct SpriteInstance {
+    std::string imageKey;
+    std::shared_ptr<const Image> image;
+    glm::vec3 position;
+    glm::vec2 size;
+    glm::vec4 tint;
+};
+
+// Draws every sprite as one indexed quad stream per atlas page
+class SpriteBatch {
+public:
+    explicit SpriteBatch(TextureAtlas& atlas) : atlas(atlas) {
+    }
+
+    void add(SpriteInstance sprite);
+    void draw();
+    void clear();
+
+private:
+    struct PageStream {
+        GLuint vao = 0;
+        GLuint vbo = 0;
+        GLsizei indexCount = 0;
+    };
+
+    TextureAtlas& atlas;
+    std::vector<SpriteInstance> sprites;
+    std::vector<PageStream> streams;
+    GLuint quadIndices = 0;
+    size_t quadCapacity = 0;
+    GLuint program = 0;
+    bool dirty = false;
+    bool registered = false;
+    unsigned long seenEvictions = 0;
+
+    void rebuild();
+    void reserveQuadIndices(size_t quads);
+};
+
+#endif //ATLAS_TEXTURE_ATLAS_H
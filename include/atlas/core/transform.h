@@ -0,0 +1,86 @@
+/*
+* transform.h
+* As part of the Atlas project
+* Created by Maxims Enterprise in 2024
+* --------------------------------------
+* Description: Per-object transform hierarchy
+* Copyright (c) 2024 Maxims Enterprise
+*/
+
+#ifndef ATLAS_TRANSFORM_H
+#define ATLAS_TRANSFORM_H
+
+#include <vector>
+#include <glm/glm.hpp>
+#include <GL/glew.h>
+
+using TransformNode = int;
+constexpr TransformNode ATLAS_NO_TRANSFORM = -1;
+
+// Local transforms with parent/child relationships. World matrices are only recomputed
+// for dirty subtrees, one depth level at a time, and packed into a texture buffer that
+// shaders index with the node of each draw. Any number of shapes can share a node
+class TransformHierarchy {
+public:
+    TransformNode create(TransformNode parent = ATLAS_NO_TRANSFORM, const glm::mat4& local = glm::mat4(1.0f));
+    void setLocal(TransformNode node, const glm::mat4& local);
+    const glm::mat4& getLocal(TransformNode node) const;
+    const glm::mat4& getWorld(TransformNode node) const;
+
+    TransformNode getParent(TransformNode node) const {
+        return parents[node];
+    }
+
+    void update();
+    void upload();
+    void clear();
+
+    GLuint getTexture() const {
+        return texture;
+    }
+
+    size_t size() const {
+        return parents.size();
+    }
+
+    // True while local matrices changed since the last update
+    bool isDirty() const {
+        return dirty;
+    }
+
+    // Nodes whose world matrix was recomputed by the last update
+    const std::vector<TransformNode>& getUpdated() const {
+        return updated;
+    }
+
+    // Nodes below this count in a level are updated on the calling thread
+    size_t parallelThreshold = 4096;
+
+private:
+    std::vector<TransformNode> parents;
+    std::vector<int> depths;
+    std::vector<std::vector<TransformNode>> children;
+    std::vector<glm::mat4> locals;
+    std::vector<glm::mat4> worlds;
+
+    // Nodes whose local matrix changed, grouped by depth
+    std::vector<std::vector<TransformNode>> pending;
+    std::vector<unsigned int> stamps;
+    // Scratch lists kept between updates so that their capacity is reused
+    std::vector<TransformNode> level;
+    std::vector<TransformNode> next;
+    std::vector<TransformNode> updated;
+    unsigned int stamp = 0;
+    bool dirty = false;
+
+    // Range of world matrices that changed since the last upload
+    size_t uploadBegin = 0;
+    size_t uploadEnd = 0;
+    size_t bufferCapacity = 0;
+    GLuint buffer = 0;
+    GLuint texture = 0;
+
+    void updateLevel(const std::vector<TransformNode>& nodes);
+};
+
+#endif //ATLAS_TRANSFORM_H
@@ -36,6 +36,10 @@ public:
         functions.clear();
     }
 
+    size_t size() const {
+        return functions.size();
+    }
+
 private:
     std::vector<std::function<T()>> functions;
 };
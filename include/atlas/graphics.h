@@ -10,10 +10,15 @@
 #ifndef ATLAS_GRAPHICS_H
 #define ATLAS_GRAPHICS_H
 
+#include <algorithm>
+#include <array>
+#include <initializer_list>
 #include <string>
+#include <vector>
 
 enum class AtlasShader {
     Default,
+    Sprite,
 };
 
 struct Shader {
@@ -35,6 +40,10 @@ enum class AtlasPostProcessing {
     None,
     Blur,
     InvertAllColors,
+    Tint,
+    Gamma,
+    ColorGrade,
+    Custom,
 };
 
 struct PostProcessUnit {
@@ -42,18 +51,61 @@ struct PostProcessUnit {
     const char* vertexShader;
     const char* fragmentShader;
     AtlasPostProcessing type;
+    // Pointwise effects see these as `vec4 params[4]`: Tint uses params[0].rgb, Gamma uses
+    // params[0].x and ColorGrade uses params[0..2] as matrix columns plus params[3] as offset
+    std::array<float, 16> parameters;
+    // GLSL body of a Custom effect, which reads and writes `vec4 color`
+    std::string snippet;
 
     explicit PostProcessUnit(AtlasPostProcessing type) : type(type), isLocal(false), vertexShader(nullptr),
-                                                         fragmentShader(nullptr) {
+                                                         fragmentShader(nullptr),
+                                                         parameters(defaultParameters(type)) {
+    }
+
+    PostProcessUnit(AtlasPostProcessing type, std::initializer_list<float> values) : PostProcessUnit(type) {
+        std::copy_n(values.begin(), std::min(values.size(), parameters.size()), parameters.begin());
     }
 
     PostProcessUnit(const char* vertexShader, const char* fragmentShader) : type(AtlasPostProcessing::None),
                                                                             isLocal(true),
                                                                             vertexShader(vertexShader),
-                                                                            fragmentShader(fragmentShader) {
+                                                                            fragmentShader(fragmentShader),
+                                                                            parameters() {
+    }
+
+    static PostProcessUnit fromSnippet(std::string snippet, std::initializer_list<float> values = {}) {
+        PostProcessUnit unit(AtlasPostProcessing::Custom, values);
+        unit.snippet = std::move(snippet);
+        return unit;
+    }
+
+    // Pointwise effects only read the pixel they write, so consecutive ones can share a pass
+    bool isPointwise() const {
+        return !isLocal && type != AtlasPostProcessing::None && type != AtlasPostProcessing::Blur;
+    }
+
+private:
+    static std::array<float, 16> defaultParameters(AtlasPostProcessing type) {
+        switch (type) {
+        case AtlasPostProcessing::Tint:
+            return {1.0f, 1.0f, 1.0f, 1.0f};
+        case AtlasPostProcessing::Gamma:
+            return {2.2f};
+        case AtlasPostProcessing::ColorGrade:
+            return {1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f};
+        default:
+            return {};
+        }
     }
 };
 
+// Decoded image in RGBA8, with the first row at the top
+struct Image {
+    int width = 0;
+    int height = 0;
+    std::vector<unsigned char> pixels;
+};
+
 class Component {
 public:
     std::string name;
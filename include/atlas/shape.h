@@ -12,8 +12,11 @@
 #include "graphics.h"
 #include "units.h"
 #include <string>
+#include <vector>
+#include <memory>
 
 #include "core/core_rendering.h"
+#include "core/tessellation.h"
 
 class Triangle : public Component {
 public:
@@ -30,4 +33,117 @@ public:
     void render();
 };
 
+// Base of the shapes that are tessellated into indexed meshes. Identical shapes
+// (same parameters, color and level of detail) share one mesh from the tessellation cache
+class Primitive : public Component {
+public:
+    Color color;
+    Position position;
+    Shader shader;
+
+    TransformNode node = ATLAS_NO_TRANSFORM;
+
+    Primitive(std::string name, Color color, Position position, Shader shader);
+    virtual ~Primitive() = default;
+    void setShader(Shader shader);
+    void attachTo(TransformNode node);
+    void render();
+    // The geometry render() draws, tessellated at the current level of detail
+    CoreGeometry tessellated() const;
+
+protected:
+    virtual PrimitiveKind kind() const = 0;
+    virtual std::vector<float> parameters() const = 0;
+    virtual CoreGeometry tessellate(int lod) const = 0;
+    int levelOfDetail() const;
+
+    // Curved shapes pick their level of detail from the size of this half extent on screen,
+    // and keep picking it while they are drawn. Shapes with straight edges return zero
+    virtual glm::vec2 curveExtent() const {
+        return glm::vec2(0.0f);
+    }
+
+    // Tessellates a copy of the shape at any level of detail, valid after the shape is gone
+    virtual std::function<CoreGeometry(int)> curveTessellation() const {
+        return nullptr;
+    }
+};
+
+class Rectangle : public Primitive {
+public:
+    Size size;
+
+    Rectangle(std::string name, Color color, Size size, Position position, Shader shader = Shader(AtlasShader::Default));
+
+protected:
+    PrimitiveKind kind() const override;
+    std::vector<float> parameters() const override;
+    CoreGeometry tessellate(int lod) const override;
+};
+
+// Ellipses are positioned by their center
+class Ellipse : public Primitive {
+public:
+    Size radii;
+
+    Ellipse(std::string name, Color color, Size radii, Position position, Shader shader = Shader(AtlasShader::Default));
+
+protected:
+    PrimitiveKind kind() const override;
+    std::vector<float> parameters() const override;
+    CoreGeometry tessellate(int lod) const override;
+    glm::vec2 curveExtent() const override;
+    std::function<CoreGeometry(int)> curveTessellation() const override;
+};
+
+class Circle : public Ellipse {
+public:
+    Circle(std::string name, Color color, float radius, Position position, Shader shader = Shader(AtlasShader::Default));
+};
+
+// Simple polygon, convex or concave, with points relative to its position
+class Polygon : public Primitive {
+public:
+    std::vector<Point> points;
+
+    Polygon(std::string name, Color color, std::vector<Point> points, Position position,
+            Shader shader = Shader(AtlasShader::Default));
+
+protected:
+    PrimitiveKind kind() const override;
+    std::vector<float> parameters() const override;
+    CoreGeometry tessellate(int lod) const override;
+};
+
+// Stroked polyline with mitered joins, with points relative to its position
+class Path : public Primitive {
+public:
+    std::vector<Point> points;
+    float thickness;
+    bool closed;
+
+    Path(std::string name, Color color, std::vector<Point> points, float thickness, Position position,
+         bool closed = false, Shader shader = Shader(AtlasShader::Default));
+
+protected:
+    PrimitiveKind kind() const override;
+    std::vector<float> parameters() const override;
+    CoreGeometry tessellate(int lod) const override;
+};
+
+// Textured quad packed into the shared texture atlas. Sprites using the same image key
+// share one atlas region, and all sprites are drawn by the sprite batch
+class Sprite : public Component {
+public:
+    std::string imageKey;
+    std::shared_ptr<const Image> image;
+    Size size;
+    Position position;
+    Color tint;
+
+    Sprite(std::string name, std::string imageKey, std::shared_ptr<const Image> image, Size size, Position position,
+           Color tint = Color(255, 255, 255));
+    void render();
+};
+
 #endif //ATLAS_SHAPE_H
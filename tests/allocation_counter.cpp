@@ -0,0 +1,49 @@
+/*
+* allocation_counter.cpp
+* As part of the Atlas project
+* Created by Maxims Enterprise in 2024
+* --------------------------------------
+* Description: Global operator new replacement that counts heap allocations
+* Copyright (c) 2024 Maxims Enterprise
+*/
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "test.h"
+
+// Every heap allocation of a test linking this file goes through these
+static std::atomic<size_t> allocationCount{0};
+
+size_t countedAllocations() {
+    return allocationCount.load();
+}
+
+void* operator new(size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* pointer = std::malloc(size == 0 ? 1 : size)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept {
+    std::free(pointer);
+}
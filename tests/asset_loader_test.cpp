@@ -0,0 +1,130 @@
+/*
+* asset_loader_test.cpp
+* As part of the Atlas project
+* Created by Maxims Enterprise in 2024
+* --------------------------------------
+* Description: Tests for image decoding and waiting on asset handles
+* Copyright (c) 2024 Maxims Enterprise
+*/
+
+#include <cstdio>
+#include <fstream>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "atlas/core/asset_loader.h"
+#include "test.h"
+
+static const std::string imagePath = "atlas_asset_loader_test.pnm";
+
+static void writeImage(const std::string& header, const std::vector<unsigned char>& samples) {
+    std::ofstream file(imagePath, std::ios::binary);
+    file << header;
+    file.write(reinterpret_cast<const char*>(samples.data()), static_cast<std::streamsize>(samples.size()));
+}
+
+static bool rejects(const std::string& header, const std::vector<unsigned char>& samples) {
+    writeImage(header, samples);
+    try {
+        decodeImage(imagePath);
+    }
+    catch (const std::runtime_error&) {
+        return true;
+    }
+    return false;
+}
+
+static void testPixmap() {
+    // Comments may appear anywhere in the header; RGB gets an opaque alpha
+    writeImage("P6\n# made by hand\n2 1\n255\n", {10, 20, 30, 40, 50, 60});
+    Image image = decodeImage(imagePath);
+    CHECK(image.width == 2 && image.height == 1);
+    CHECK(image.pixels == std::vector<unsigned char>({10, 20, 30, 255, 40, 50, 60, 255}));
+}
+
+static void testArbitraryMap() {
+    writeImage("P7\nWIDTH 1\nHEIGHT 2\nDEPTH 4\nMAXVAL 255\nTUPLTYPE RGB_ALPHA\nENDHDR\n",
+               {1, 2, 3, 4, 5, 6, 7, 8});
+    Image alpha = decodeImage(imagePath);
+    CHECK(alpha.width == 1 && alpha.height == 2);
+    CHECK(alpha.pixels == std::vector<unsigned char>({1, 2, 3, 4, 5, 6, 7, 8}));
+
+    writeImage("P7\nWIDTH 1\nHEIGHT 1\nDEPTH 3\nMAXVAL 255\nTUPLTYPE RGB\nENDHDR\n", {9, 8, 7});
+    Image rgb = decodeImage(imagePath);
+    CHECK(rgb.pixels == std::vector<unsigned char>({9, 8, 7, 255}));
+}
+
+static void testMaxValue() {
+    // Smaller ranges are stretched to 0..255
+    writeImage("P6 1 1 15\n", {0, 15, 7});
+    Image image = decodeImage(imagePath);
+    CHECK(image.pixels == std::vector<unsigned char>({0, 255, 119, 255}));
+
+    // Two bytes per sample, and a range that cannot hold any value
+    CHECK(rejects("P6 1 1 65535\n", {0, 0, 0, 0, 0, 0}));
+    CHECK(rejects("P6 1 1 0\n", {0, 0, 0}));
+}
+
+static void testMalformed() {
+    CHECK(rejects("P3 1 1 255\n", {0, 0, 0}));
+    CHECK(rejects("P6 1 x 255\n", {0, 0, 0}));
+    CHECK(rejects("P6 -1 1 255\n", {0, 0, 0}));
+    CHECK(rejects("P6 99999999999 1 255\n", {0, 0, 0}));
+    CHECK(rejects("P6 0 1 255\n", {}));
+    CHECK(rejects("P6 1 1", {}));
+    CHECK(rejects("P7\nWIDTH 1\nHEIGHT 1\nDEPTH 2\nMAXVAL 255\nENDHDR\n", {0, 0}));
+    CHECK(rejects("P7\nWIDTH 1\nHEIGHT 1\nDEPTH 3\nMAXVAL 255\n", {0, 0, 0}));
+
+    // Headers that promise more pixels than the file holds
+    CHECK(rejects("P6 2 2 255\n", {1, 2, 3, 4, 5, 6, 7, 8, 9}));
+    CHECK(rejects("P7\nWIDTH 2\nHEIGHT 1\nDEPTH 4\nMAXVAL 255\nENDHDR\n", {1, 2, 3, 4}));
+
+    bool missing = false;
+    try {
+        decodeImage("atlas_asset_loader_test_missing.pnm");
+    }
+    catch (const std::runtime_error&) {
+        missing = true;
+    }
+    CHECK(missing);
+}
+
+static void testHandleWaits() {
+    // On the thread that uploads, an unresolved handle refuses to wait
+    std::promise<int> promise;
+    AssetHandle<int> handle(promise.get_future().share(), std::this_thread::get_id());
+    bool refused = false;
+    try {
+        handle.get();
+    }
+    catch (const std::logic_error&) {
+        refused = true;
+    }
+    CHECK(refused);
+
+    promise.set_value(7);
+    CHECK(handle.isResident());
+    CHECK(handle.get() == 7);
+
+    // Other threads simply wait until the upload thread resolves it
+    std::promise<int> later;
+    AssetHandle<int> waited(later.get_future().share(), std::this_thread::get_id());
+    int value = 0;
+    std::thread reader([&waited, &value]() { value = waited.get(); });
+    later.set_value(3);
+    reader.join();
+    CHECK(value == 3);
+}
+
+int main() {
+    testPixmap();
+    testArbitraryMap();
+    testMaxValue();
+    testMalformed();
+    testHandleWaits();
+    std::remove(imagePath.c_str());
+    return testResult();
+}
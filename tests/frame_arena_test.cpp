@@ -0,0 +1,88 @@
+/*
+* frame_arena_test.cpp
+* As part of the Atlas project
+* Created by Maxims Enterprise in 2024
+* --------------------------------------
+* Description: Tests that warmed-up frames make no heap allocations
+* Copyright (c) 2024 Maxims Enterprise
+*/
+
+#include <cstdint>
+
+#include "atlas/core/frame_arena.h"
+#include "test.h"
+
+// Transient data of a frame: a command list, vertex staging and uniform payloads
+static void simulateFrame(FrameArena& arena, size_t commands) {
+    FrameVector<uint32_t> commandList{ArenaAllocator<uint32_t>(arena)};
+    for (size_t i = 0; i < commands; i++) {
+        commandList.push_back(static_cast<uint32_t>(i));
+    }
+
+    FrameVector<float> staging(commands * 7, 0.0f, ArenaAllocator<float>(arena));
+    for (size_t i = 0; i < 8; i++) {
+        auto* uniforms = static_cast<float*>(arena.allocate(16 * sizeof(float), 64));
+        uniforms[0] = staging[i];
+    }
+}
+
+static void testAlignment() {
+    FrameArena arena(256);
+    arena.allocate(1, 1);
+    for (size_t alignment : {4, 16, 64, 256}) {
+        void* pointer = arena.allocate(8, alignment);
+        CHECK(reinterpret_cast<uintptr_t>(pointer) % alignment == 0);
+    }
+}
+
+static void testSteadyState() {
+    // Start far too small so that the first frames overflow to the heap
+    size_t start = countedAllocations();
+    FrameArena arena(256);
+    CHECK(countedAllocations() > start);
+    for (int frame = 0; frame < 4; frame++) {
+        simulateFrame(arena, 500);
+        arena.reset();
+    }
+    CHECK(arena.heapAllocations() > 1);
+    CHECK(arena.capacity() >= arena.peak());
+
+    size_t arenaAllocations = arena.heapAllocations();
+    size_t before = countedAllocations();
+    for (int frame = 0; frame < 100; frame++) {
+        simulateFrame(arena, 500);
+        arena.reset();
+    }
+    CHECK(countedAllocations() == before);
+    CHECK(arena.heapAllocations() == arenaAllocations);
+}
+
+static void testRing() {
+    FrameArenaRing ring;
+    for (int frame = 0; frame < 4; frame++) {
+        ring.nextFrame();
+        simulateFrame(ring.current(), 2000);
+    }
+
+    // Data of the previous frame lives in the other arena and survives the switch
+    auto* previous = static_cast<int*>(ring.current().allocate(sizeof(int)));
+    *previous = 42;
+    ring.nextFrame();
+    ring.current().allocate(sizeof(int));
+    CHECK(*previous == 42);
+
+    size_t before = countedAllocations();
+    for (int frame = 0; frame < 100; frame++) {
+        ring.nextFrame();
+        simulateFrame(ring.current(), 2000);
+    }
+    CHECK(countedAllocations() == before);
+    CHECK(ring.peak() > 0);
+}
+
+int main() {
+    testAlignment();
+    testSteadyState();
+    testRing();
+    return testResult();
+}
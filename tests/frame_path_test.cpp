@@ -0,0 +1,84 @@
+/*
+* frame_path_test.cpp
+* As part of the Atlas project
+* Created by Maxims Enterprise in 2024
+* --------------------------------------
+* Description: Tests that the CPU side of a warmed-up frame makes no heap allocations
+* Copyright (c) 2024 Maxims Enterprise
+*/
+
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "atlas/application.h"
+#include "test.h"
+
+// Everything the main loop does between polling events and drawing, without the GPU uploads
+static void simulateFrame(const std::vector<TransformNode>& moving, int frame) {
+    TransformHierarchy& transforms = Application::transforms;
+    for (size_t i = 0; i < moving.size(); i++) {
+        float x = 0.001f * static_cast<float>((frame + static_cast<int>(i)) % 100);
+        transforms.setLocal(moving[i], glm::translate(glm::mat4(1.0f), glm::vec3(x, 0.0f, 0.0f)));
+    }
+
+    transforms.update();
+    Application::damage.nodesMoved(transforms.getUpdated());
+    Application::damage.checkMatrices();
+    if (Application::damage.isDamaged()) {
+        Application::damage.collect(Application::instance.getPostProcessSpread(), Application::width,
+                                    Application::height);
+    }
+}
+
+// Builds a hierarchy wide enough for some levels to be updated in parallel, with a tracked
+// box on every leaf, and returns the nodes that move every frame
+static std::vector<TransformNode> buildScene() {
+    TransformHierarchy& transforms = Application::transforms;
+    std::vector<TransformNode> moving;
+    for (int group = 0; group < 8; group++) {
+        TransformNode root = transforms.create();
+        moving.push_back(root);
+        for (int leaf = 0; leaf < 64; leaf++) {
+            float x = -0.9f + 0.025f * static_cast<float>(leaf);
+            TransformNode node = transforms.create(root, glm::translate(glm::mat4(1.0f), glm::vec3(x, 0.0f, 0.0f)));
+            Application::damage.track(node, glm::vec3(0.0f), glm::vec3(0.01f));
+            if (leaf % 16 == 0) {
+                moving.push_back(node);
+            }
+        }
+    }
+    return moving;
+}
+
+static void testSteadyFrames(size_t parallelThreshold) {
+    Application::transforms.parallelThreshold = parallelThreshold;
+    std::vector<TransformNode> moving = buildScene();
+
+    // Warm-up grows every scratch list to its steady size
+    for (int frame = 0; frame < 16; frame++) {
+        simulateFrame(moving, frame);
+    }
+
+    size_t before = countedAllocations();
+    for (int frame = 16; frame < 216; frame++) {
+        simulateFrame(moving, frame);
+    }
+    CHECK(countedAllocations() == before);
+    CHECK(!Application::transforms.getUpdated().empty());
+}
+
+int main() {
+    Application::width = 800;
+    Application::height = 600;
+
+    // A blur makes the damage padded, and the spread is read on every frame
+    Application::instance.setPostProcess(PostProcessUnit(AtlasPostProcessing::Blur));
+    CHECK(Application::instance.getPostProcessSpread() > 0);
+
+    testSteadyFrames(4096);
+    testSteadyFrames(16);
+
+    Application::jobs.shutdown();
+    return testResult();
+}
@@ -0,0 +1,123 @@
+/*
+* job_system_test.cpp
+* As part of the Atlas project
+* Created by Maxims Enterprise in 2024
+* --------------------------------------
+* Description: Tests for fork-join waits, shutdown and allocation-free parallelFor
+* Copyright (c) 2024 Maxims Enterprise
+*/
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "atlas/core/job_system.h"
+#include "test.h"
+
+static void testParallelFor() {
+    JobSystem jobs(3);
+    std::vector<std::atomic<int>> visits(10000);
+    jobs.parallelFor(0, visits.size(), 0, [&visits](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            visits[i]++;
+        }
+    });
+
+    bool once = true;
+    for (const std::atomic<int>& count : visits) {
+        once = once && count == 1;
+    }
+    CHECK(once);
+}
+
+static void testNestedForkJoin() {
+    JobSystem jobs(2);
+    std::atomic<int> leaves{0};
+    JobCounter parents(0);
+    for (int i = 0; i < 8; i++) {
+        jobs.submit([&jobs, &leaves]() {
+            jobs.parallelFor(0, 16, 1, [&leaves](size_t, size_t) { leaves++; });
+        }, &parents);
+    }
+    jobs.wait(parents);
+    CHECK(leaves == 8 * 16);
+}
+
+static void testWaitSkipsUnrelatedJobs() {
+    JobSystem jobs(1);
+
+    // Keep the only worker busy so that nobody but the main thread can run jobs
+    std::atomic<bool> release{false};
+    std::atomic<bool> blocking{false};
+    jobs.submit([&release, &blocking]() {
+        blocking = true;
+        while (!release) {
+            std::this_thread::yield();
+        }
+    });
+    while (!blocking) {
+        std::this_thread::yield();
+    }
+
+    // The job waited on is older than the unrelated one, which would be popped first otherwise
+    JobCounter counter(0);
+    std::atomic<bool> countedRan{false};
+    std::atomic<bool> unrelatedRan{false};
+    jobs.submit([&countedRan]() { countedRan = true; }, &counter);
+    jobs.submit([&unrelatedRan]() { unrelatedRan = true; });
+    jobs.wait(counter);
+    CHECK(countedRan);
+    CHECK(!unrelatedRan);
+
+    // The main thread runs every chunk itself, but leaves the unrelated job queued
+    std::atomic<int> chunks{0};
+    jobs.parallelFor(0, 64, 8, [&chunks](size_t, size_t) { chunks++; });
+    CHECK(chunks == 8);
+    CHECK(!unrelatedRan);
+
+    release = true;
+    jobs.shutdown();
+    CHECK(unrelatedRan);
+}
+
+static void testSubmitAfterShutdown() {
+    JobSystem jobs(2);
+    jobs.shutdown();
+
+    JobCounter counter(0);
+    bool ran = false;
+    jobs.submit([&ran]() { ran = true; }, &counter);
+    CHECK(ran);
+    CHECK(counter == 0);
+    jobs.wait(counter);
+}
+
+static void testParallelForAllocations() {
+    JobSystem jobs(3);
+    std::vector<float> values(4096, 1.0f);
+    auto scale = [&values](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            values[i] *= 1.0001f;
+        }
+    };
+
+    // Warm-up starts the workers and grows the queues
+    for (int frame = 0; frame < 16; frame++) {
+        jobs.parallelFor(0, values.size(), 0, scale);
+    }
+
+    size_t before = countedAllocations();
+    for (int frame = 0; frame < 200; frame++) {
+        jobs.parallelFor(0, values.size(), 0, scale);
+    }
+    CHECK(countedAllocations() == before);
+}
+
+int main() {
+    testParallelFor();
+    testNestedForkJoin();
+    testWaitSkipsUnrelatedJobs();
+    testSubmitAfterShutdown();
+    testParallelForAllocations();
+    return testResult();
+}
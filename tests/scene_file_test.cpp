@@ -0,0 +1,219 @@
+/*
+* scene_file_test.cpp
+* As part of the Atlas project
+* Created by Maxims Enterprise in 2024
+* --------------------------------------
+* Description: Tests for baking, mapping, merging and rejecting scene files
+* Copyright (c) 2024 Maxims Enterprise
+*/
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "atlas/core/scene_file.h"
+#include "atlas/shape.h"
+#include "test.h"
+
+static const std::string scenePath = "atlas_scene_file_test.ascn";
+static const std::string brokenPath = "atlas_scene_file_test_broken.ascn";
+
+static std::vector<char> readFile(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    return {std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+}
+
+static void writeFile(const std::string& path, const std::vector<char>& bytes) {
+    std::ofstream file(path, std::ios::binary);
+    file.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+}
+
+// Opening the file must throw, and leave nothing mapped behind
+static bool rejects(const std::vector<char>& bytes) {
+    writeFile(brokenPath, bytes);
+    try {
+        BakedScene scene(brokenPath);
+    }
+    catch (const std::runtime_error&) {
+        return true;
+    }
+    return false;
+}
+
+static SceneFileHeader headerOf(const std::vector<char>& bytes) {
+    SceneFileHeader header{};
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    return header;
+}
+
+template <typename T>
+static void patch(std::vector<char>& bytes, uint64_t offset, T value) {
+    std::memcpy(bytes.data() + offset, &value, sizeof(value));
+}
+
+static void testRoundTrip() {
+    Rectangle rectangle("rectangle", Color(255, 0, 0), Size(2, 1), Position(0, 0));
+    Polygon polygon("notch", Color(0, 255, 0), {{0, 0}, {2, 0}, {2, 2}, {1, 1}, {0, 2}}, Position(3, 0));
+    Rectangle custom("custom", Color(0, 0, 255), Size(1, 1), Position(0, 3),
+                     Shader("shaders/custom.vert", "shaders/custom.frag"));
+
+    SceneBaker baker;
+    baker.add(rectangle);
+    baker.add(polygon);
+    baker.add(custom);
+    CHECK(baker.size() == 3);
+    CHECK(baker.write(scenePath));
+
+    BakedScene scene(scenePath);
+    CHECK(scene.size() == 3);
+    CHECK(scene.getShapeName(0) == "rectangle");
+    CHECK(scene.getShapeName(1) == "notch");
+    CHECK(scene.getShapeName(2) == "custom");
+
+    // Shapes are stored back to back, each with its own vertices
+    std::vector<CoreGeometry> geometries = {rectangle.tessellated(), polygon.tessellated(), custom.tessellated()};
+    std::vector<char> bytes = readFile(scenePath);
+    SceneFileHeader header = headerOf(bytes);
+    CHECK(header.version == ATLAS_SCENE_VERSION);
+    CHECK(header.programCount == 2);
+    CHECK(header.nodeCount == 0);
+
+    uint32_t vertexCount = 0;
+    uint32_t indexCount = 0;
+    for (size_t i = 0; i < geometries.size(); i++) {
+        SceneShapeRecord shape{};
+        std::memcpy(&shape, bytes.data() + header.shapesOffset + i * sizeof(SceneShapeRecord), sizeof(shape));
+        CHECK(shape.baseVertex == static_cast<int32_t>(vertexCount));
+        CHECK(shape.vertexCount == geometries[i].vertices.size());
+        CHECK(shape.firstIndex == indexCount);
+        CHECK(shape.indexCount == geometries[i].indices.size());
+
+        const auto* vertices = reinterpret_cast<const CoreVertex*>(bytes.data() + header.verticesOffset);
+        CHECK(std::memcmp(vertices + shape.baseVertex, geometries[i].vertices.data(),
+                          geometries[i].vertices.size() * sizeof(CoreVertex)) == 0);
+        vertexCount += shape.vertexCount;
+        indexCount += shape.indexCount;
+    }
+    CHECK(header.vertexCount == vertexCount);
+    CHECK(header.indexCount == indexCount);
+}
+
+static void testTruncated() {
+    std::vector<char> bytes = readFile(scenePath);
+    CHECK(rejects({}));
+    CHECK(rejects(std::vector<char>(bytes.begin(), bytes.begin() + sizeof(SceneFileHeader) - 1)));
+
+    // Cutting off the end loses the string section
+    CHECK(rejects(std::vector<char>(bytes.begin(), bytes.end() - 1)));
+
+    std::vector<char> farSection = bytes;
+    patch(farSection, offsetof(SceneFileHeader, indexCount), headerOf(bytes).indexCount + 1000u);
+    CHECK(rejects(farSection));
+}
+
+static void testCorrupted() {
+    const std::vector<char> bytes = readFile(scenePath);
+    SceneFileHeader header = headerOf(bytes);
+
+    std::vector<char> magic = bytes;
+    magic[0] = 'X';
+    CHECK(rejects(magic));
+
+    std::vector<char> version = bytes;
+    patch(version, offsetof(SceneFileHeader, version), ATLAS_SCENE_VERSION + 1);
+    CHECK(rejects(version));
+
+    std::vector<char> misaligned = bytes;
+    patch(misaligned, offsetof(SceneFileHeader, shapesOffset), header.shapesOffset + 4);
+    CHECK(rejects(misaligned));
+
+    // The last shape ends exactly at the end of the vertex section, any further is out of range
+    uint64_t lastShape = header.shapesOffset + (header.shapeCount - 1) * sizeof(SceneShapeRecord);
+    SceneShapeRecord shape{};
+    std::memcpy(&shape, bytes.data() + lastShape, sizeof(shape));
+
+    std::vector<char> baseVertex = bytes;
+    patch(baseVertex, lastShape + offsetof(SceneShapeRecord, baseVertex), shape.baseVertex + 1);
+    CHECK(rejects(baseVertex));
+
+    std::vector<char> negative = bytes;
+    patch(negative, lastShape + offsetof(SceneShapeRecord, baseVertex), int32_t(-1));
+    CHECK(rejects(negative));
+
+    std::vector<char> vertexCount = bytes;
+    patch(vertexCount, lastShape + offsetof(SceneShapeRecord, vertexCount), shape.vertexCount + 1);
+    CHECK(rejects(vertexCount));
+
+    std::vector<char> indices = bytes;
+    patch(indices, lastShape + offsetof(SceneShapeRecord, indexCount), shape.indexCount + 1);
+    CHECK(rejects(indices));
+
+    std::vector<char> program = bytes;
+    patch(program, lastShape + offsetof(SceneShapeRecord, program), header.programCount);
+    CHECK(rejects(program));
+
+    std::vector<char> node = bytes;
+    patch(node, lastShape + offsetof(SceneShapeRecord, node), int32_t(0));
+    CHECK(rejects(node));
+
+    std::vector<char> strings = bytes;
+    strings.back() = 'x';
+    CHECK(rejects(strings));
+}
+
+static void testMergedGeometry() {
+    CoreGeometry triangle{{{glm::vec3(0, 0, 0), glm::vec4(1.0f)},
+                           {glm::vec3(1, 0, 0), glm::vec4(1.0f)},
+                           {glm::vec3(0, 1, 0), glm::vec4(1.0f)}},
+                          {0, 1, 2}};
+    Rectangle moved("moved", Color(255, 255, 255), Size(1, 1), Position(5, 2));
+    CoreGeometry rectangle = moved.tessellated();
+
+    SceneBaker baker;
+    baker.add("triangle", triangle);
+    baker.add(moved);
+    CHECK(baker.write(scenePath));
+
+    // The second shape is rebased after the first and keeps its offset
+    CoreGeometry merged = BakedScene(scenePath).getGeometry();
+    CHECK(merged.vertices.size() == 3 + rectangle.vertices.size());
+    CHECK(merged.indices.size() == 3 + rectangle.indices.size());
+    CHECK(merged.indices[0] == 0 && merged.indices[2] == 2);
+    for (size_t i = 0; i < rectangle.indices.size(); i++) {
+        CHECK(merged.indices[3 + i] == 3 + rectangle.indices[i]);
+    }
+    for (size_t i = 0; i < rectangle.vertices.size(); i++) {
+        glm::vec3 expected = rectangle.vertices[i].position + glm::vec3(5, 2, 0);
+        CHECK(glm::length(merged.vertices[3 + i].position - expected) < 1e-5f);
+    }
+
+    // Indices are only checked once the geometry is read
+    std::vector<char> bytes = readFile(scenePath);
+    SceneFileHeader header = headerOf(bytes);
+    patch(bytes, header.indicesOffset, GLuint(3));
+    writeFile(brokenPath, bytes);
+    BakedScene broken(brokenPath);
+    bool threw = false;
+    try {
+        broken.getGeometry();
+    }
+    catch (const std::runtime_error&) {
+        threw = true;
+    }
+    CHECK(threw);
+}
+
+int main() {
+    testRoundTrip();
+    testTruncated();
+    testCorrupted();
+    testMergedGeometry();
+    std::remove(scenePath.c_str());
+    std::remove(brokenPath.c_str());
+    return testResult();
+}
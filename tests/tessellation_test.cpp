@@ -0,0 +1,145 @@
+/*
+* tessellation_test.cpp
+* As part of the Atlas project
+* Created by Maxims Enterprise in 2024
+* --------------------------------------
+* Description: Tests for polygon and stroke tessellation
+* Copyright (c) 2024 Maxims Enterprise
+*/
+
+#include <sstream>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "atlas/application.h"
+#include "atlas/core/tessellation.h"
+#include "test.h"
+
+static const glm::vec4 color(1.0f);
+
+static float signedArea(glm::vec3 a, glm::vec3 b, glm::vec3 c) {
+    return ((b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x)) * 0.5f;
+}
+
+// Checks that every triangle is counter-clockwise and that together they cover the expected area
+static void checkFilled(const CoreGeometry& geometry, float expectedArea) {
+    CHECK(geometry.indices.size() % 3 == 0);
+
+    float area = 0.0f;
+    for (size_t i = 0; i + 2 < geometry.indices.size(); i += 3) {
+        float triangle = signedArea(geometry.vertices[geometry.indices[i]].position,
+                                    geometry.vertices[geometry.indices[i + 1]].position,
+                                    geometry.vertices[geometry.indices[i + 2]].position);
+        CHECK(triangle >= 0.0f);
+        area += triangle;
+    }
+    CHECK_NEAR(area, expectedArea, 1e-4f);
+}
+
+// Distance from a stroke point to the vertices on either side of it
+static float offsetAt(const CoreGeometry& geometry, size_t point) {
+    return glm::length(geometry.vertices[point * 2].position - geometry.vertices[point * 2 + 1].position) * 0.5f;
+}
+
+static void testConvexPolygon() {
+    CoreGeometry square = tessellatePolygon({{0, 0}, {2, 0}, {2, 2}, {0, 2}}, color);
+    CHECK(square.vertices.size() == 4);
+    CHECK(square.indices.size() == 6);
+    checkFilled(square, 4.0f);
+
+    std::vector<glm::vec2> hexagon;
+    for (int i = 0; i < 6; i++) {
+        float angle = static_cast<float>(M_PI) * static_cast<float>(i) / 3.0f;
+        hexagon.emplace_back(std::cos(angle), std::sin(angle));
+    }
+    CoreGeometry filled = tessellatePolygon(hexagon, color);
+    CHECK(filled.indices.size() == 12);
+    checkFilled(filled, 3.0f * std::sqrt(3.0f) / 2.0f);
+}
+
+static void testConcavePolygon() {
+    // Square with a notch cut into its top edge
+    CoreGeometry notched = tessellatePolygon({{0, 0}, {2, 0}, {2, 2}, {1, 1}, {0, 2}}, color);
+    CHECK(notched.indices.size() == 9);
+    checkFilled(notched, 3.0f);
+
+    // The same outline given clockwise is reoriented before clipping
+    CoreGeometry clockwise = tessellatePolygon({{0, 2}, {1, 1}, {2, 2}, {2, 0}, {0, 0}}, color);
+    CHECK(clockwise.indices.size() == 9);
+    checkFilled(clockwise, 3.0f);
+}
+
+static void testCollinearPolygon() {
+    // Extra points on the bottom edge must not leave holes or overlapping triangles
+    CoreGeometry rectangle = tessellatePolygon({{0, 0}, {1, 0}, {2, 0}, {3, 0}, {3, 1}, {0, 1}}, color);
+    CHECK(rectangle.indices.size() == 12);
+    checkFilled(rectangle, 3.0f);
+
+    CoreGeometry square = tessellatePolygon({{0, 0}, {1, 0}, {2, 0}, {2, 2}, {0, 2}}, color);
+    CHECK(square.indices.size() == 9);
+    checkFilled(square, 4.0f);
+}
+
+static void testInvalidPolygon() {
+    CHECK(tessellatePolygon({{0, 0}, {1, 0}}, color).indices.empty());
+
+    // This outline crosses itself so that no ear is left: the failure is reported instead of
+    // silently dropping the points
+    std::ostringstream errors;
+    std::streambuf* previous = std::cerr.rdbuf(errors.rdbuf());
+    CoreGeometry crossing = tessellatePolygon({{3, 3}, {1, 1}, {2, 0}, {0, 2}, {3, 2}}, color);
+    std::cerr.rdbuf(previous);
+    CHECK(crossing.indices.size() < 9);
+    CHECK(errors.str().find("Failed to tessellate polygon") != std::string::npos);
+}
+
+static void testStroke() {
+    // Open ends are offset by half of the thickness along the segment normal
+    CoreGeometry line = tessellateStroke({{0, 0}, {1, 0}}, 0.2f, false, color);
+    CHECK(line.vertices.size() == 4);
+    CHECK(line.indices.size() == 6);
+    CHECK_NEAR(line.vertices[0].position.y, 0.1f, 1e-6f);
+    CHECK_NEAR(line.vertices[1].position.y, -0.1f, 1e-6f);
+
+    // A right angle joins with a miter of half of the thickness times the square root of two
+    CoreGeometry corner = tessellateStroke({{0, 0}, {1, 0}, {1, 1}}, 0.2f, false, color);
+    CHECK(corner.indices.size() == 12);
+    CHECK_NEAR(offsetAt(corner, 1), 0.1f * std::sqrt(2.0f), 1e-5f);
+
+    // Almost reversing the direction would produce a spike, the miter is clamped to the limit
+    CoreGeometry spike = tessellateStroke({{0, 0}, {1, 0}, {0, 0.02f}}, 0.2f, false, color);
+    CHECK_NEAR(offsetAt(spike, 1), 0.1f * ATLAS_MITER_LIMIT, 1e-5f);
+
+    // Closed strokes join the last point back to the first, repeated and duplicate points are dropped
+    CoreGeometry closed = tessellateStroke({{0, 0}, {1, 0}, {1, 0}, {1, 1}, {0, 1}, {0, 0}}, 0.2f, true, color);
+    CHECK(closed.vertices.size() == 8);
+    CHECK(closed.indices.size() == 24);
+    CHECK_NEAR(offsetAt(closed, 0), 0.1f * std::sqrt(2.0f), 1e-5f);
+}
+
+static void testLevelOfDetailFollowsNode() {
+    Application::width = 800;
+    Application::height = 600;
+
+    // Scaling the node up makes the same circle bigger on screen, so it needs more segments
+    TransformNode node = Application::transforms.create();
+    Application::transforms.update();
+    int small = lodForPlacement(glm::vec3(0.0f), node, glm::vec2(0.01f));
+
+    Application::transforms.setLocal(node, glm::scale(glm::mat4(1.0f), glm::vec3(10.0f)));
+    Application::transforms.update();
+    int large = lodForPlacement(glm::vec3(0.0f), node, glm::vec2(0.01f));
+    CHECK(large > small);
+    CHECK(large == lodForPlacement(glm::vec3(0.0f), ATLAS_NO_TRANSFORM, glm::vec2(0.1f)));
+}
+
+int main() {
+    testConvexPolygon();
+    testConcavePolygon();
+    testCollinearPolygon();
+    testInvalidPolygon();
+    testStroke();
+    testLevelOfDetailFollowsNode();
+    return testResult();
+}
@@ -0,0 +1,44 @@
+/*
+* test.h
+* As part of the Atlas project
+* Created by Maxims Enterprise in 2024
+* --------------------------------------
+* Description: Minimal checks shared by the atlas tests
+* Copyright (c) 2024 Maxims Enterprise
+*/
+
+#ifndef ATLAS_TEST_H
+#define ATLAS_TEST_H
+
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+
+inline int& testFailures() {
+    static int failures = 0;
+    return failures;
+}
+
+// Failed checks are reported and counted; main returns testResult() so ctest sees them
+#define CHECK(condition)                                                                              \
+    do {                                                                                              \
+        if (!(condition)) {                                                                           \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " #condition << std::endl;   \
+            testFailures()++;                                                                         \
+        }                                                                                             \
+    } while (false)
+
+#define CHECK_NEAR(value, expected, tolerance) CHECK(std::abs((value) - (expected)) <= (tolerance))
+
+// Heap allocations made so far; only defined in tests that link allocation_counter.cpp
+size_t countedAllocations();
+
+inline int testResult() {
+    if (testFailures() > 0) {
+        std::cerr << testFailures() << " checks failed" << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+#endif //ATLAS_TEST_H
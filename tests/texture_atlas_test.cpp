@@ -0,0 +1,139 @@
+/*
+* texture_atlas_test.cpp
+* As part of the Atlas project
+* Created by Maxims Enterprise in 2024
+* --------------------------------------
+* Description: Tests for atlas packing, padding and page eviction
+* Copyright (c) 2024 Maxims Enterprise
+*/
+
+#include <algorithm>
+#include <sstream>
+#include <vector>
+
+#include "atlas/core/texture_atlas.h"
+#include "test.h"
+
+static bool overlaps(const AtlasRect& a, const AtlasRect& b) {
+    return a.x < b.x + b.width && b.x < a.x + a.width && a.y < b.y + b.height && b.y < a.y + a.height;
+}
+
+static void testPackerFitting() {
+    SkylinePacker packer(64, 64);
+    std::vector<AtlasRect> placed;
+    for (int i = 0; i < 4; i++) {
+        AtlasRect rect{};
+        CHECK(packer.insert(32, 32, rect));
+        CHECK(rect.x >= 0 && rect.y >= 0 && rect.x + rect.width <= 64 && rect.y + rect.height <= 64);
+        for (const AtlasRect& other : placed) {
+            CHECK(!overlaps(rect, other));
+        }
+        placed.push_back(rect);
+    }
+    CHECK_NEAR(packer.occupancy(), 1.0f, 1e-6f);
+
+    AtlasRect rect{};
+    CHECK(!packer.insert(1, 1, rect));
+
+    packer.reset();
+    CHECK_NEAR(packer.occupancy(), 0.0f, 1e-6f);
+    CHECK(!packer.insert(65, 1, rect));
+    CHECK(packer.insert(64, 64, rect));
+}
+
+static void testPackerSkyline() {
+    SkylinePacker packer(64, 64);
+    AtlasRect first{}, second{}, third{};
+
+    // Each rectangle goes where its top edge ends up lowest
+    CHECK(packer.insert(40, 10, first));
+    CHECK(first.x == 0 && first.y == 0);
+    CHECK(packer.insert(20, 30, second));
+    CHECK(second.x == 40 && second.y == 0);
+    CHECK(packer.insert(30, 5, third));
+    CHECK(third.x == 0 && third.y == 10);
+    CHECK(!overlaps(third, first) && !overlaps(third, second));
+}
+
+static void testLayoutPadding() {
+    AtlasLayout layout(64, 2, 1);
+    AtlasRect a{}, b{};
+    const AtlasRegion* first = layout.place("a", 10, 10, a);
+    const AtlasRegion* second = layout.place("b", 10, 10, b);
+    CHECK(first && second);
+    if (!first || !second) {
+        return;
+    }
+
+    // The rectangles to fill include the padding, the regions only cover the image inside it
+    CHECK(a.width == 14 && a.height == 14);
+    CHECK(!overlaps(a, b));
+    CHECK_NEAR(first->uvMin.x * 64.0f, static_cast<float>(a.x + 2), 1e-4f);
+    CHECK_NEAR(first->uvMin.y * 64.0f, static_cast<float>(a.y + 2), 1e-4f);
+    CHECK_NEAR((first->uvMax.x - first->uvMin.x) * 64.0f, 10.0f, 1e-4f);
+    CHECK_NEAR((first->uvMax.y - first->uvMin.y) * 64.0f, 10.0f, 1e-4f);
+
+    // Neighbouring images stay at least two paddings apart
+    float gapX = std::max(second->uvMin.x - first->uvMax.x, first->uvMin.x - second->uvMax.x) * 64.0f;
+    float gapY = std::max(second->uvMin.y - first->uvMax.y, first->uvMin.y - second->uvMax.y) * 64.0f;
+    CHECK(std::max(gapX, gapY) >= 4.0f - 1e-4f);
+
+    // An image only fits if its padding does too
+    std::ostringstream errors;
+    std::streambuf* previous = std::cerr.rdbuf(errors.rdbuf());
+    AtlasRect rect{};
+    CHECK(layout.place("wide", 61, 10, rect) == nullptr);
+    std::cerr.rdbuf(previous);
+    CHECK(layout.place("exact", 60, 10, rect) != nullptr);
+}
+
+static void testLayoutEviction() {
+    AtlasLayout layout(32, 0, 2);
+    AtlasRect rect{};
+
+    CHECK(layout.place("a", 32, 32, rect));
+    layout.nextFrame();
+    CHECK(layout.place("b", 32, 32, rect));
+    layout.nextFrame();
+    CHECK(layout.pageCount() == 2);
+
+    // "b" is used this frame, so the page holding "a" is the least recently used
+    CHECK(layout.find("b"));
+    const AtlasRegion* c = layout.place("c", 32, 32, rect);
+    CHECK(c && c->page == 0);
+    CHECK(layout.evictions == 1);
+    CHECK(layout.find("a") == nullptr);
+    CHECK(layout.find("b") != nullptr);
+
+    // Both pages are now in use this frame and cannot be evicted
+    std::ostringstream errors;
+    std::streambuf* previous = std::cerr.rdbuf(errors.rdbuf());
+    CHECK(layout.place("d", 32, 32, rect) == nullptr);
+    std::cerr.rdbuf(previous);
+    CHECK(layout.evictions == 1);
+}
+
+static void testLayoutEvictsEmptiest() {
+    AtlasLayout layout(32, 0, 2);
+    AtlasRect rect{};
+
+    CHECK(layout.place("full", 32, 32, rect));
+    CHECK(layout.place("small", 16, 16, rect));
+    CHECK(layout.occupancy(0) > layout.occupancy(1));
+    layout.nextFrame();
+
+    // Both pages were last used in the same frame, the emptier one is given up
+    const AtlasRegion* region = layout.place("new", 32, 32, rect);
+    CHECK(region && region->page == 1);
+    CHECK(layout.find("full") != nullptr);
+    CHECK(layout.find("small") == nullptr);
+}
+
+int main() {
+    testPackerFitting();
+    testPackerSkyline();
+    testLayoutPadding();
+    testLayoutEviction();
+    testLayoutEvictsEmptiest();
+    return testResult();
+}
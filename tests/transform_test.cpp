@@ -0,0 +1,136 @@
+/*
+* transform_test.cpp
+* As part of the Atlas project
+* Created by Maxims Enterprise in 2024
+* --------------------------------------
+* Description: Tests for dirty subtree propagation and level-ordered transform updates
+* Copyright (c) 2024 Maxims Enterprise
+*/
+
+#include <algorithm>
+#include <random>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "atlas/application.h"
+#include "test.h"
+
+static glm::mat4 translation(float x, float y) {
+    return glm::translate(glm::mat4(1.0f), glm::vec3(x, y, 0.0f));
+}
+
+static bool wasUpdated(const TransformHierarchy& transforms, TransformNode node) {
+    const std::vector<TransformNode>& updated = transforms.getUpdated();
+    return std::find(updated.begin(), updated.end(), node) != updated.end();
+}
+
+static bool nearlyEqual(const glm::mat4& a, const glm::mat4& b) {
+    for (int column = 0; column < 4; column++) {
+        for (int row = 0; row < 4; row++) {
+            if (std::abs(a[column][row] - b[column][row]) > 1e-4f) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static void testParentInvalidatesDescendants() {
+    TransformHierarchy transforms;
+    TransformNode root = transforms.create();
+    TransformNode child = transforms.create(root, translation(1, 0));
+    TransformNode grandchild = transforms.create(child, translation(0, 1));
+    transforms.update();
+    CHECK(transforms.getUpdated().size() == 3);
+
+    transforms.setLocal(root, translation(5, 0));
+    CHECK(transforms.isDirty());
+    transforms.update();
+    CHECK(!transforms.isDirty());
+    CHECK(transforms.getUpdated().size() == 3);
+    CHECK(wasUpdated(transforms, child) && wasUpdated(transforms, grandchild));
+    CHECK(nearlyEqual(transforms.getWorld(grandchild), translation(6, 1)));
+
+    // Nothing changed, nothing is recomputed
+    transforms.update();
+    CHECK(transforms.getUpdated().empty());
+}
+
+static void testSiblingsStayUntouched() {
+    TransformHierarchy transforms;
+    TransformNode root = transforms.create();
+    TransformNode left = transforms.create(root, translation(-1, 0));
+    TransformNode leftChild = transforms.create(left);
+    TransformNode right = transforms.create(root, translation(1, 0));
+    TransformNode rightChild = transforms.create(right);
+    transforms.update();
+
+    transforms.setLocal(left, translation(-2, 0));
+    transforms.update();
+    CHECK(transforms.getUpdated().size() == 2);
+    CHECK(wasUpdated(transforms, left) && wasUpdated(transforms, leftChild));
+    CHECK(!wasUpdated(transforms, root) && !wasUpdated(transforms, right) && !wasUpdated(transforms, rightChild));
+    CHECK(nearlyEqual(transforms.getWorld(leftChild), translation(-2, 0)));
+
+    // A node changed together with its parent is still only computed once
+    transforms.setLocal(right, translation(2, 0));
+    transforms.setLocal(rightChild, translation(0, 3));
+    transforms.setLocal(root, translation(0, 1));
+    transforms.update();
+    CHECK(transforms.getUpdated().size() == 5);
+    CHECK(nearlyEqual(transforms.getWorld(rightChild), translation(2, 4)));
+}
+
+// Parents are always created first, so walking the nodes in order computes every world matrix
+static std::vector<glm::mat4> serialWorlds(const TransformHierarchy& transforms) {
+    std::vector<glm::mat4> worlds(transforms.size());
+    for (size_t i = 0; i < worlds.size(); i++) {
+        TransformNode node = static_cast<TransformNode>(i);
+        TransformNode parent = transforms.getParent(node);
+        worlds[i] = parent == ATLAS_NO_TRANSFORM ? transforms.getLocal(node)
+                                                 : worlds[parent] * transforms.getLocal(node);
+    }
+    return worlds;
+}
+
+static void testMatchesSerialReference(size_t parallelThreshold) {
+    TransformHierarchy transforms;
+    transforms.parallelThreshold = parallelThreshold;
+
+    std::mt19937 random(7);
+    std::uniform_real_distribution<float> offset(-1.0f, 1.0f);
+    std::uniform_real_distribution<float> angle(0.0f, 6.28f);
+    auto randomLocal = [&]() {
+        return glm::rotate(translation(offset(random), offset(random)), angle(random), glm::vec3(0, 0, 1));
+    };
+
+    // Wide levels, so that the parallel path splits them into several chunks
+    for (int i = 0; i < 6000; i++) {
+        TransformNode parent = i < 16 ? ATLAS_NO_TRANSFORM : static_cast<TransformNode>(random() % i);
+        transforms.create(parent, randomLocal());
+    }
+
+    for (int round = 0; round < 4; round++) {
+        transforms.update();
+        std::vector<glm::mat4> expected = serialWorlds(transforms);
+        bool matches = true;
+        for (size_t i = 0; i < expected.size(); i++) {
+            matches = matches && nearlyEqual(transforms.getWorld(static_cast<TransformNode>(i)), expected[i]);
+        }
+        CHECK(matches);
+
+        for (int change = 0; change < 500; change++) {
+            transforms.setLocal(static_cast<TransformNode>(random() % transforms.size()), randomLocal());
+        }
+    }
+}
+
+int main() {
+    testParentInvalidatesDescendants();
+    testSiblingsStayUntouched();
+    testMatchesSerialReference(4096);
+    testMatchesSerialReference(1);
+    Application::jobs.shutdown();
+    return testResult();
+}